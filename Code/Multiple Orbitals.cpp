@@ -5,6 +5,31 @@
 #include <vector>
 #include <random>
 #include <iostream>
+#include <cstdint>
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <thread>
+#include <chrono>
+#include <map>
+#include <tuple>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+#include <fstream>
+#include <string>
+#include <memory>
+#include <complex>
+#include <charconv>
+#include <cstdio>
+#include <cstring>
+#include <cfloat>
+#if !defined(_WIN32)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
 
 // =======================
 // Constants and Parameters
@@ -17,99 +42,4187 @@ constexpr int WINDOW_HEIGHT = 600;
 constexpr int NUM_POINTS = 10000;
 constexpr float ROTATION_SPEED = 0.01f;
 constexpr float VIBRATION_FREQ = 0.1f;
+constexpr bool USE_QUANTIZED_POINTS = true; // 16-bit point storage (6 bytes instead of 12)
+constexpr int PROGRESSIVE_FIRST_CHUNK = 64;  // Small enough to land within one frame
+constexpr int PROGRESSIVE_CHUNK_SIZE = 1024; // Chunks double up to this size
+constexpr float TARGET_FRAME_MS = 16.6f;
+constexpr int MIN_ACTIVE_POINTS = 1000;
+constexpr int MAX_ACTIVE_POINTS = 4000000;
+constexpr float MAX_REFILL_SECONDS = 2.0f; // A new orbital's cloud must stream in within this time
+constexpr int MESH_RESOLUTION = 128;
+constexpr float MESH_ENCLOSED_FRACTION = 0.9f;
+constexpr int ISOVALUE_SAMPLES = 1 << 18;
+constexpr int VOLUME_IMAGE_WIDTH = 1920;
+constexpr int VOLUME_IMAGE_HEIGHT = 1080;
+constexpr int RAYMARCH_STEPS = 256; // Steps across the bounding sphere's diameter
+constexpr float VOLUME_OPACITY = 8.0f; // Optical depth of a chord of length radius at the reference density
+constexpr float SUPERPOSITION_TIME_SCALE = 2.0f; // Atomic time units per second of animation
+constexpr int BOHMIAN_POINTS = 20000; // Each costs a few basis gradient evaluations per frame
 
 // =======================
 // Orbital Definition
 // =======================
 
+// Hydrogen-like species: nuclear charge Z and the electron's reduced mass in
+// electron masses. Lengths scale as a0 / (Z mu) and energies as Z^2 mu.
+struct Species {
+    int charge = 1;
+    float reduced_mass = 1.0f; // 1 for an infinitely heavy nucleus
+    const char* name = "H";
+
+    float bohr_radius() const { return BOHR_RADIUS / (charge * reduced_mass); }
+    bool operator==(const Species& other) const { return charge == other.charge && reduced_mass == other.reduced_mass; }
+};
+
+// mu = M / (1 + M) for a nucleus of M electron masses
+constexpr float electron_reduced_mass(float nuclear_mass) {
+    return nuclear_mass / (1.0f + nuclear_mass);
+}
+
+// Cycled with Z; the first entry is the default
+const Species SPECIES[] = {
+    {1, 1.0f, "H (fixed nucleus)"},
+    {1, electron_reduced_mass(1836.15267f), "H"},    // Proton
+    {2, electron_reduced_mass(7294.29954f), "He+"},  // Alpha particle
+    {3, electron_reduced_mass(12786.3933f), "Li2+"}, // 7Li nucleus
+};
+
 struct Orbital {
     int n, l, m;
     float scale;
     std::string name;
     sf::Vector3f color; // RGB color
+    Species species = SPECIES[0];
+};
+
+// =======================
+// Quantum Functions
+// =======================
+
+// Normalization and (2m-1)!! of P_m^m, without the Condon-Shortley sign:
+// sqrt((2m+1) / 4pi (2m-1)!! / (2m)!!)
+float legendre_start(int m) {
+    float value = (2.0f * m + 1.0f) / (4.0f * PI);
+    for (int i = 1; i <= m; ++i)
+        value *= (2.0f * i - 1.0f) / (2.0f * i);
+    return std::sqrt(value);
+}
+
+// Coefficient of the normalized recurrence P_l = a_l (x P_(l-1) - P_(l-2) / a_(l-1))
+float legendre_coefficient(int l, int m) {
+    return std::sqrt((4.0f * l * l - 1.0f) / (static_cast<float>(l * l) - static_cast<float>(m * m)));
+}
+
+// N_lm P_l^m(x) / (1 - x^2)^(m/2) for m >= 0, without the Condon-Shortley phase.
+// The recurrence runs on normalized values, which stay in float range at
+// l in the hundreds where P_l^m and the factorials in N_lm do not.
+float normalized_legendre(int l, int m, float x) {
+    float prev = 0.0f, curr = legendre_start(m), a_prev = 1.0f;
+    for (int ll = m + 1; ll <= l; ++ll) {
+        float a = legendre_coefficient(ll, m);
+        float next = a * (x * curr - prev / a_prev);
+        prev = curr;
+        curr = next;
+        a_prev = a;
+    }
+    return curr;
+}
+
+// Polar part of the real harmonic: sqrt(2) N_l|m| P_l^|m|(cos theta), without sqrt(2) for m = 0
+float real_harmonic_polar(int l, int m, float theta) {
+    int am = std::abs(m);
+    if (am > l)
+        return 0.0f; // Invalid
+    float norm = am % 2 ? -1.0f : 1.0f; // Condon-Shortley phase
+    if (m != 0)
+        norm *= std::sqrt(2.0f);
+    return norm * normalized_legendre(l, am, std::cos(theta)) * std::pow(std::sin(theta), static_cast<float>(am));
+}
+
+// Azimuthal part: cos(m phi) for m > 0, sin(|m| phi) for m < 0
+float real_harmonic_azimuth(int m, float phi) {
+    if (m == 0)
+        return 1.0f;
+    return m > 0 ? std::cos(m * phi) : std::sin(-m * phi);
+}
+
+// Real spherical harmonics (explicit s and p, recurrence for d, f and above)
+float real_spherical_harmonic(const Orbital& orbital, float theta, float phi) {
+    int l = orbital.l;
+    int m = orbital.m;
+
+    if (l == 0 && m == 0) // 1s
+        return 0.5f * std::sqrt(1.0f / PI);
+
+    if (l == 1 && m == 0) // 2pz
+        return std::sqrt(3.0f / (4.0f * PI)) * std::cos(theta);
+
+    if (l == 1 && m == 1) // 2px
+        return -std::sqrt(3.0f / (4.0f * PI)) * std::sin(theta) * std::cos(phi);
+
+    if (l == 1 && m == -1) // 2py
+        return -std::sqrt(3.0f / (4.0f * PI)) * std::sin(theta) * std::sin(phi);
+
+    return real_harmonic_polar(l, m, theta) * real_harmonic_azimuth(m, phi);
+}
+
+// Past this magnitude the Laguerre recurrence is rescaled into log_scale
+constexpr float LAGUERRE_RESCALE = 1e30f;
+
+// Generalized Laguerre polynomial L_k^alpha(x) = value * e^log_scale, by
+// recurrence. L_k^alpha reaches 1e40 by n = 100, so the terms are rescaled
+// whenever they grow past LAGUERRE_RESCALE.
+float generalized_laguerre(int k, float alpha, float x, float& log_scale) {
+    log_scale = 0.0f;
+    float prev = 1.0f;
+    if (k == 0)
+        return prev;
+    float curr = 1.0f + alpha - x;
+    for (int i = 1; i < k; ++i) {
+        float next = ((2.0f * i + 1.0f + alpha - x) * curr - (i + alpha) * prev) / (i + 1.0f);
+        prev = curr;
+        curr = next;
+        if (std::fabs(curr) > LAGUERRE_RESCALE) {
+            prev /= LAGUERRE_RESCALE;
+            curr /= LAGUERRE_RESCALE;
+            log_scale += std::log(LAGUERRE_RESCALE);
+        }
+    }
+    return curr;
+}
+
+// L_k^alpha(x) and its derivative from the same recurrence, both scaled by
+// e^-log_scale, using x L_k^alpha'(x) = k L_k^alpha(x) - (k + alpha) L_(k-1)^alpha(x)
+// (and L_k^alpha' = -L_(k-1)^(alpha+1) near x = 0, where that form is 0 / 0)
+void generalized_laguerre_slope(int k, float alpha, float x, float& value, float& slope, float& log_scale) {
+    log_scale = 0.0f;
+    if (k == 0) {
+        value = 1.0f;
+        slope = 0.0f;
+        return;
+    }
+    float prev = 1.0f, curr = 1.0f + alpha - x;
+    for (int i = 1; i < k; ++i) {
+        float next = ((2.0f * i + 1.0f + alpha - x) * curr - (i + alpha) * prev) / (i + 1.0f);
+        prev = curr;
+        curr = next;
+        if (std::fabs(curr) > LAGUERRE_RESCALE) {
+            prev /= LAGUERRE_RESCALE;
+            curr /= LAGUERRE_RESCALE;
+            log_scale += std::log(LAGUERRE_RESCALE);
+        }
+    }
+    value = curr;
+    if (x > 1e-3f) {
+        slope = (k * curr - (k + alpha) * prev) / x;
+    } else {
+        float slope_scale;
+        slope = -generalized_laguerre(k - 1, alpha + 1.0f, x, slope_scale) * std::exp(slope_scale - log_scale);
+    }
+}
+
+// log of sqrt((2 / n a0)^3 (n-l-1)! / (2n (n+l)!)), the R_nl normalization,
+// with a0 the species' Bohr radius
+float radial_log_norm(int n, int l, float a0) {
+    return 0.5f * (3.0f * std::log(2.0f / (n * a0)) + std::lgamma(n - l) - std::lgamma(n + l + 1.0f) - std::log(2.0f * n));
+}
+
+float radial_function(int n, int l, float r, float a0) {
+    if (n == 1) // 1s
+        return 2.0f * std::exp(-r / a0) / std::pow(a0, 1.5f);
+
+    if (n == 2 && l == 0) // 2s
+        return (1.0f / (2.0f * std::sqrt(2.0f))) * (2.0f - r / a0) * std::exp(-r / (2.0f * a0)) / std::pow(a0, 1.5f);
+
+    if (n == 2 && l == 1) // 2p
+        return (1.0f / (2.0f * std::sqrt(6.0f))) * (r / a0) * std::exp(-r / (2.0f * a0)) / std::pow(a0, 1.5f);
+
+    if (l < 0 || l >= n)
+        return 0.0f; // Invalid
+
+    // N e^(-rho/2) rho^l L_{n-l-1}^{2l+1}(rho)
+    // The prefactors and the Laguerre scale are combined in one exponent so
+    // nothing overflows or underflows before the product, up to n in the hundreds.
+    float rho = 2.0f * r / (n * a0);
+    float log_power = l > 0 ? l * std::log(rho) : 0.0f;
+    float log_scale;
+    float laguerre = generalized_laguerre(n - l - 1, 2.0f * l + 1.0f, rho, log_scale);
+    return std::exp(radial_log_norm(n, l, a0) - 0.5f * rho + log_power + log_scale) * laguerre;
+}
+
+// Breathing animation applied to every density: +-10% over time
+inline float vibration_scale(float time) {
+    return 1.0f + 0.1f * std::sin(VIBRATION_FREQ * time);
+}
+
+float probability_density(const Orbital& orbital, float r, float theta, float phi, float time) {
+    float R = radial_function(orbital.n, orbital.l, r, orbital.species.bohr_radius());
+    float Y = real_spherical_harmonic(orbital, theta, phi);
+    float psi = R * Y;
+    float vibration = vibration_scale(time);
+    return psi * psi * vibration;
+}
+
+// =======================
+// Batched Density Kernel
+// =======================
+
+// Structure-of-arrays coordinates, the layout the batched functions take
+struct PointBatch {
+    std::vector<float> x, y, z;
+
+    explicit PointBatch(size_t count = 0) : x(count), y(count), z(count) {}
+    PointBatch(const sf::Vector3f* points, size_t count) { assign(points, count); }
+    explicit PointBatch(const std::vector<sf::Vector3f>& points) : PointBatch(points.data(), points.size()) {}
+
+    void assign(const sf::Vector3f* points, size_t count) {
+        x.resize(count);
+        y.resize(count);
+        z.resize(count);
+        for (size_t i = 0; i < count; ++i) {
+            x[i] = points[i].x;
+            y[i] = points[i].y;
+            z[i] = points[i].z;
+        }
+    }
+};
+
+constexpr size_t KERNEL_LANES = 256; // Points per block of angular_batch
+
+// Cartesian, trig-free form of psi for evaluating many points at once.
+// sin^|m|(theta) cos(m phi) and sin^|m|(theta) sin(|m| phi) are the real and
+// imaginary parts of ((x + iy) / r)^|m|; the rest of N_l|m| P_l^|m| is a
+// polynomial in cos(theta) = z / r, built by the recurrence of normalized_legendre.
+struct OrbitalKernel {
+    int n, l, m, am;
+    float a0;           // Bohr radius of the species
+    float log_norm;     // Radial normalization (log)
+    float angular_norm; // sqrt(2) (-1)^|m|
+    float complex_norm; // Same for the e^{i m phi} form: no sqrt(2), (-1)^|m| again for m < 0
+    float q_start;      // legendre_start(|m|)
+    std::vector<float> coefficients; // legendre_coefficient(ll, |m|) for ll = |m| + 1..l
+
+    explicit OrbitalKernel(const Orbital& orbital)
+        : n(orbital.n), l(orbital.l), m(orbital.m), am(std::abs(orbital.m)), a0(orbital.species.bohr_radius()),
+          log_norm(radial_log_norm(orbital.n, orbital.l, a0)), q_start(legendre_start(std::abs(orbital.m))) {
+        angular_norm = (am % 2 ? -1.0f : 1.0f) * (m != 0 ? std::sqrt(2.0f) : 1.0f);
+        complex_norm = m != 0 ? angular_norm / std::sqrt(2.0f) : angular_norm;
+        if (m < 0 && am % 2)
+            complex_norm = -complex_norm;
+        for (int ll = am + 1; ll <= l; ++ll)
+            coefficients.push_back(legendre_coefficient(ll, am));
+    }
+
+    float radial(float r) const {
+        float rho = 2.0f * r / (n * a0);
+        float log_power = l > 0 ? l * std::log(rho) : 0.0f;
+        float log_scale;
+        float laguerre = generalized_laguerre(n - l - 1, 2.0f * l + 1.0f, rho, log_scale);
+        return std::exp(log_norm - 0.5f * rho + log_power + log_scale) * laguerre;
+    }
+
+    // Polynomial part of N_l|m| P_l^|m|(c)
+    float legendre_polynomial(float c) const {
+        float q_prev = 0.0f, q = q_start, a_prev = 1.0f;
+        for (float a : coefficients) {
+            float next = a * (c * q - q_prev / a_prev);
+            q_prev = q;
+            q = next;
+            a_prev = a;
+        }
+        return q;
+    }
+
+    // ((u + iv))^|m| by repeated rotation
+    void azimuthal_power(float u, float v, float& re, float& im) const {
+        re = 1.0f;
+        im = 0.0f;
+        for (int i = 0; i < am; ++i) {
+            float t = re * u - im * v;
+            im = re * v + im * u;
+            re = t;
+        }
+    }
+
+    // g = R and dg = r^|m| d(R / r^|m|) / dr, the radial factor of
+    // psi = norm (R / r^|m|) Q(z / r) (x +- iy)^|m| with the r^|m| of the
+    // Cartesian power moved back into it, so neither overflows at high |m|.
+    // L_k^a'(x) = -L_(k-1)^(a+1)(x).
+    void reduced_radial(float r, float& g, float& dg) const {
+        r = std::fmax(r, 1e-20f);
+        float rho = 2.0f * r / (n * a0);
+        float log_power = l > 0 ? l * std::log(rho) : 0.0f;
+        float laguerre, laguerre_slope, log_scale;
+        generalized_laguerre_slope(n - l - 1, 2.0f * l + 1.0f, rho, laguerre, laguerre_slope, log_scale);
+        float e = std::exp(log_norm - 0.5f * rho + log_power + log_scale);
+        g = e * laguerre;
+        dg = e * (((l - am) / r - 1.0f / (n * a0)) * laguerre + 2.0f / (n * a0) * laguerre_slope);
+    }
+
+    // Polynomial part of N_l|m| P_l^|m|(c) and its derivative, by the differentiated recurrence
+    void legendre_polynomial(float c, float& q, float& dq) const {
+        float q_prev = 0.0f, dq_prev = 0.0f, a_prev = 1.0f;
+        q = q_start;
+        dq = 0.0f;
+        for (float a : coefficients) {
+            float next = a * (c * q - q_prev / a_prev);
+            float next_slope = a * (q + c * dq - dq_prev / a_prev);
+            q_prev = q;
+            dq_prev = dq;
+            q = next;
+            dq = next_slope;
+            a_prev = a;
+        }
+    }
+
+    // psi and its gradient from psi = norm g(r) Q(z / r) (x +- iy)^|m| / r^|m|
+    // (g from reduced_radial). With complex_form the e^{i m phi} orbital,
+    // otherwise the real one (imaginary parts zero).
+    void gradient(float x, float y, float z, bool complex_form, std::complex<float>& psi, std::complex<float>* grad) const {
+        float r = std::sqrt(x * x + y * y + z * z);
+        float inv_r = 1.0f / std::fmax(r, 1e-20f);
+        float g, dg, q, dq;
+        reduced_radial(r, g, dg);
+        legendre_polynomial(z * inv_r, q, dq);
+
+        // F = g(r) Q(z / r); dc/dx = -zx / r^3, dc/dy = -zy / r^3, dc/dz = (x^2 + y^2) / r^3
+        float inv_r3 = inv_r * inv_r * inv_r;
+        float f = g * q;
+        float radial_part = dg * q * inv_r, polar_part = g * dq * inv_r3;
+        float fx = (radial_part - polar_part * z) * x;
+        float fy = (radial_part - polar_part * z) * y;
+        float fz = radial_part * z + polar_part * (x * x + y * y);
+
+        // P = w^|m| with w = (x + iy) / r, and dP/dw / r (the Cartesian derivative, scaled like P)
+        std::complex<float> w(x * inv_r, y * inv_r), p(1.0f, 0.0f), dp(0.0f, 0.0f);
+        for (int i = 0; i < am; ++i) {
+            dp = dp * w + p;
+            p *= w;
+        }
+        dp *= inv_r;
+        const std::complex<float> I(0.0f, 1.0f);
+        std::complex<float> a, ax, ay; // Azimuthal factor and its x, y derivatives
+        float norm;
+        if (complex_form) {
+            norm = complex_norm;
+            a = m < 0 ? std::conj(p) : p;
+            ax = m < 0 ? std::conj(dp) : dp;
+            ay = m < 0 ? -I * std::conj(dp) : I * dp;
+        } else {
+            norm = angular_norm;
+            if (m > 0) {
+                a = p.real();
+                ax = dp.real();
+                ay = -dp.imag();
+            } else if (m < 0) {
+                a = p.imag();
+                ax = dp.imag();
+                ay = dp.real();
+            } else {
+                a = 1.0f;
+                ax = ay = 0.0f;
+            }
+        }
+        psi = norm * f * a;
+        grad[0] = norm * (fx * a + f * ax);
+        grad[1] = norm * (fy * a + f * ay);
+        grad[2] = norm * fz * a;
+    }
+
+    // Real psi and its gradient with the same factorization, in real arithmetic
+    float real_gradient(float x, float y, float z, float* grad) const {
+        float r = std::sqrt(x * x + y * y + z * z);
+        float inv_r = 1.0f / std::fmax(r, 1e-20f);
+        float g, dg, q, dq;
+        reduced_radial(r, g, dg);
+        legendre_polynomial(z * inv_r, q, dq);
+        float inv_r3 = inv_r * inv_r * inv_r;
+        float f = g * q;
+        float radial_part = dg * q * inv_r, polar_part = g * dq * inv_r3;
+        float fx = (radial_part - polar_part * z) * x;
+        float fy = (radial_part - polar_part * z) * y;
+        float fz = radial_part * z + polar_part * (x * x + y * y);
+
+        // Re or Im of ((x + iy) / r)^|m| and of its w-derivative over r
+        float u = x * inv_r, v = y * inv_r;
+        float p_re = 1.0f, p_im = 0.0f, dp_re = 0.0f, dp_im = 0.0f;
+        for (int i = 0; i < am; ++i) {
+            float t = dp_re * u - dp_im * v + p_re;
+            dp_im = dp_re * v + dp_im * u + p_im;
+            dp_re = t;
+            t = p_re * u - p_im * v;
+            p_im = p_re * v + p_im * u;
+            p_re = t;
+        }
+        dp_re *= inv_r;
+        dp_im *= inv_r;
+        float a = 1.0f, ax = 0.0f, ay = 0.0f;
+        if (m > 0) {
+            a = p_re;
+            ax = dp_re;
+            ay = -dp_im;
+        } else if (m < 0) {
+            a = p_im;
+            ax = dp_im;
+            ay = dp_re;
+        }
+        grad[0] = angular_norm * (fx * a + f * ax);
+        grad[1] = angular_norm * (fy * a + f * ay);
+        grad[2] = angular_norm * fz * a;
+        return angular_norm * f * a;
+    }
+
+    // log |psi| and grad log |psi| = grad psi / psi for the real orbital, built
+    // from logs and ratios of the factors so high n neither underflows nor
+    // overflows; -inf with zero gradient on a node
+    float log_gradient(float x, float y, float z, float* grad) const {
+        float r = std::fmax(std::sqrt(x * x + y * y + z * z), 1e-20f);
+        float inv_r = 1.0f / r;
+        float rho = 2.0f * r / (n * a0);
+        float laguerre, laguerre_slope, log_scale, q, dq;
+        generalized_laguerre_slope(n - l - 1, 2.0f * l + 1.0f, rho, laguerre, laguerre_slope, log_scale);
+        legendre_polynomial(z * inv_r, q, dq);
+        float u = x * inv_r, v = y * inv_r;
+        float p_re = 1.0f, p_im = 0.0f, dp_re = 0.0f, dp_im = 0.0f; // (u + iv)^|m| and its derivative
+        for (int i = 0; i < am; ++i) {
+            float t = dp_re * u - dp_im * v + p_re;
+            dp_im = dp_re * v + dp_im * u + p_im;
+            dp_re = t;
+            t = p_re * u - p_im * v;
+            p_im = p_re * v + p_im * u;
+            p_re = t;
+        }
+        float a = 1.0f, ax = 0.0f, ay = 0.0f;
+        if (m > 0) {
+            a = p_re;
+            ax = dp_re;
+            ay = -dp_im;
+        } else if (m < 0) {
+            a = p_im;
+            ax = dp_im;
+            ay = dp_re;
+        }
+        if (laguerre == 0.0f || q == 0.0f || a == 0.0f) {
+            grad[0] = grad[1] = grad[2] = 0.0f;
+            return -INFINITY;
+        }
+
+        // grad log F = (g' / g) r_hat + (Q' / Q) grad c, plus grad a / a (a is degree |m| in x, y)
+        float radial_ratio = (l - am) * inv_r - 1.0f / (n * a0) + 2.0f / (n * a0) * laguerre_slope / laguerre;
+        float polar_ratio = dq / q * inv_r * inv_r * inv_r;
+        float azimuth_x = ax / a * inv_r, azimuth_y = ay / a * inv_r;
+        grad[0] = (radial_ratio * inv_r - polar_ratio * z) * x + azimuth_x;
+        grad[1] = (radial_ratio * inv_r - polar_ratio * z) * y + azimuth_y;
+        grad[2] = radial_ratio * inv_r * z + polar_ratio * (x * x + y * y);
+        float log_power = l > 0 ? l * std::log(rho) : 0.0f;
+        return log_norm - 0.5f * rho + log_power + log_scale + std::log(std::fabs(laguerre * angular_norm * q * a));
+    }
+
+    float angular(float x, float y, float z, float r) const {
+        float inv_r = 1.0f / std::fmax(r, 1e-20f);
+        float re, im;
+        azimuthal_power(x * inv_r, y * inv_r, re, im);
+        return angular_norm * legendre_polynomial(z * inv_r) * (m > 0 ? re : m < 0 ? im : 1.0f);
+    }
+
+    // L_(n-l-1)^(2l+1) at one block of at most KERNEL_LANES points rho, as in
+    // generalized_laguerre: curr is the value and prev the previous term, both
+    // scaled down by LAGUERRE_RESCALE^rescales. The recurrence is interchanged
+    // so each step runs across the block, and rescaling is a per-lane flag, so
+    // the steps stay branch-free.
+    void laguerre_block(const float* rho, size_t lanes, float* prev, float* curr, float* rescales) const {
+        int k = n - l - 1;
+        float alpha = 2.0f * l + 1.0f;
+        for (size_t i = 0; i < lanes; ++i) {
+            prev[i] = 1.0f;
+            curr[i] = k == 0 ? 1.0f : 1.0f + alpha - rho[i];
+            rescales[i] = 0.0f;
+        }
+        for (int j = 1; j < k; ++j) {
+            float a = 2.0f * j + 1.0f + alpha, b = j + alpha, inv = 1.0f / (j + 1.0f);
+            for (size_t i = 0; i < lanes; ++i) {
+                float next = ((a - rho[i]) * curr[i] - b * prev[i]) * inv;
+                int rescale = std::fabs(next) > LAGUERRE_RESCALE; // An int flag, where a float select would branch
+                float scale = 1.0f - rescale * (1.0f - 1.0f / LAGUERRE_RESCALE);
+                prev[i] = curr[i] * scale;
+                curr[i] = next * scale;
+                rescales[i] += rescale;
+            }
+        }
+    }
+
+    // radial() at count points, block by block through laguerre_block; only
+    // the final log and exp run per point
+    void radial_batch(const float* r, size_t count, float* out) const {
+        float rho[KERNEL_LANES], prev[KERNEL_LANES], curr[KERNEL_LANES], rescales[KERNEL_LANES];
+        float log_rescale = std::log(LAGUERRE_RESCALE);
+        for (size_t begin = 0; begin < count; begin += KERNEL_LANES) {
+            size_t lanes = std::min(KERNEL_LANES, count - begin);
+            for (size_t i = 0; i < lanes; ++i)
+                rho[i] = 2.0f * r[begin + i] / (n * a0);
+            laguerre_block(rho, lanes, prev, curr, rescales);
+            for (size_t i = 0; i < lanes; ++i) {
+                float log_power = l > 0 ? l * std::log(rho[i]) : 0.0f;
+                out[begin + i] = std::exp(log_norm - 0.5f * rho[i] + log_power + rescales[i] * log_rescale) * curr[i];
+            }
+        }
+    }
+
+    // The factors of angular() at one block of at most KERNEL_LANES points:
+    // the polynomial part q of N_l|m| P_l^|m| and ((x + iy) / r)^|m| as (re, im).
+    // The recurrences are interchanged so that each step runs across the block;
+    // the inner loops are branch-free over contiguous arrays, which the
+    // compiler vectorizes.
+    void angular_block(const float* x, const float* y, const float* z, const float* r, size_t lanes, float* q, float* re,
+                       float* im) const {
+        float u[KERNEL_LANES], v[KERNEL_LANES], c[KERNEL_LANES], q_prev[KERNEL_LANES];
+        for (size_t i = 0; i < lanes; ++i) {
+            float inv_r = 1.0f / std::max(r[i], 1e-20f);
+            u[i] = x[i] * inv_r;
+            v[i] = y[i] * inv_r;
+            c[i] = z[i] * inv_r;
+            q_prev[i] = 0.0f;
+            q[i] = q_start;
+            re[i] = 1.0f;
+            im[i] = 0.0f;
+        }
+        float a_prev = 1.0f;
+        for (float a : coefficients) {
+            for (size_t i = 0; i < lanes; ++i) {
+                float next = a * (c[i] * q[i] - q_prev[i] / a_prev);
+                q_prev[i] = q[i];
+                q[i] = next;
+            }
+            a_prev = a;
+        }
+        for (int k = 0; k < am; ++k)
+            for (size_t i = 0; i < lanes; ++i) {
+                float t = re[i] * u[i] - im[i] * v[i];
+                im[i] = re[i] * v[i] + im[i] * u[i];
+                re[i] = t;
+            }
+    }
+
+    // angular() at count points with distances r, block by block
+    void angular_batch(const float* x, const float* y, const float* z, const float* r, size_t count, float* out) const {
+        float q[KERNEL_LANES], re[KERNEL_LANES], im[KERNEL_LANES];
+        for (size_t begin = 0; begin < count; begin += KERNEL_LANES) {
+            size_t lanes = std::min(KERNEL_LANES, count - begin);
+            angular_block(x + begin, y + begin, z + begin, r + begin, lanes, q, re, im);
+            const float* azimuth = m < 0 ? im : re; // re stays 1 for m = 0
+            for (size_t i = 0; i < lanes; ++i)
+                out[begin + i] = angular_norm * q[i] * azimuth[i];
+        }
+    }
+
+    // psi and grad psi at one block of points, real and imaginary parts apart
+    struct GradientLanes {
+        float psi_re[KERNEL_LANES], psi_im[KERNEL_LANES];
+        float grad_re[3][KERNEL_LANES], grad_im[3][KERNEL_LANES];
+    };
+
+    // gradient() at one block of at most KERNEL_LANES points, with every
+    // recurrence (Laguerre, Legendre, the (x + iy)^|m| rotation) stepped across
+    // the block. Lanes too close to the nucleus for the recurrence's slope
+    // (rho <= 1e-3, see generalized_laguerre_slope) are redone by
+    // reduced_radial in a separate pass.
+    void gradient_block(const float* x, const float* y, const float* z, size_t lanes, bool complex_form, GradientLanes& out) const {
+        float r[KERNEL_LANES], inv_r[KERNEL_LANES], rho[KERNEL_LANES], g[KERNEL_LANES], dg[KERNEL_LANES];
+        float prev[KERNEL_LANES], curr[KERNEL_LANES], rescales[KERNEL_LANES];
+        for (size_t i = 0; i < lanes; ++i) {
+            r[i] = std::max(std::sqrt(x[i] * x[i] + y[i] * y[i] + z[i] * z[i]), 1e-20f);
+            inv_r[i] = 1.0f / r[i];
+            rho[i] = 2.0f * r[i] / (n * a0);
+        }
+
+        // g and dg as in reduced_radial
+        laguerre_block(rho, lanes, prev, curr, rescales);
+        int k = n - l - 1;
+        float alpha = 2.0f * l + 1.0f, log_rescale = std::log(LAGUERRE_RESCALE), inv_na0 = 1.0f / (n * a0);
+        for (size_t i = 0; i < lanes; ++i) {
+            float log_power = l > 0 ? l * std::log(rho[i]) : 0.0f;
+            float e = std::exp(log_norm - 0.5f * rho[i] + log_power + rescales[i] * log_rescale);
+            float slope = k == 0 ? 0.0f : (k * curr[i] - (k + alpha) * prev[i]) / rho[i];
+            g[i] = e * curr[i];
+            dg[i] = e * (((l - am) * inv_r[i] - inv_na0) * curr[i] + 2.0f * inv_na0 * slope);
+        }
+        for (size_t i = 0; i < lanes; ++i)
+            if (rho[i] <= 1e-3f)
+                reduced_radial(r[i], g[i], dg[i]);
+
+        // Q(c) and Q'(c), as in legendre_polynomial
+        float c[KERNEL_LANES], q[KERNEL_LANES], dq[KERNEL_LANES], q_prev[KERNEL_LANES], dq_prev[KERNEL_LANES];
+        for (size_t i = 0; i < lanes; ++i) {
+            c[i] = z[i] * inv_r[i];
+            q[i] = q_start;
+            dq[i] = q_prev[i] = dq_prev[i] = 0.0f;
+        }
+        float a_prev = 1.0f;
+        for (float a : coefficients) {
+            for (size_t i = 0; i < lanes; ++i) {
+                float next = a * (c[i] * q[i] - q_prev[i] / a_prev);
+                float next_slope = a * (q[i] + c[i] * dq[i] - dq_prev[i] / a_prev);
+                q_prev[i] = q[i];
+                dq_prev[i] = dq[i];
+                q[i] = next;
+                dq[i] = next_slope;
+            }
+            a_prev = a;
+        }
+
+        // P = ((x + iy) / r)^|m| and dP/dw
+        float u[KERNEL_LANES], v[KERNEL_LANES], p_re[KERNEL_LANES], p_im[KERNEL_LANES], dp_re[KERNEL_LANES], dp_im[KERNEL_LANES];
+        for (size_t i = 0; i < lanes; ++i) {
+            u[i] = x[i] * inv_r[i];
+            v[i] = y[i] * inv_r[i];
+            p_re[i] = 1.0f;
+            p_im[i] = dp_re[i] = dp_im[i] = 0.0f;
+        }
+        for (int step = 0; step < am; ++step)
+            for (size_t i = 0; i < lanes; ++i) {
+                float t = dp_re[i] * u[i] - dp_im[i] * v[i] + p_re[i];
+                dp_im[i] = dp_re[i] * v[i] + dp_im[i] * u[i] + p_im[i];
+                dp_re[i] = t;
+                t = p_re[i] * u[i] - p_im[i] * v[i];
+                p_im[i] = p_re[i] * v[i] + p_im[i] * u[i];
+                p_re[i] = t;
+            }
+
+        // The azimuthal factor a and its x, y derivatives as fixed combinations
+        // of P and dP, chosen per orbital as in gradient(): P or its conjugate
+        // in complex form, Re P or Im P for the real orbital
+        float norm = complex_form ? complex_norm : angular_norm;
+        float take_re = complex_form || m >= 0 ? 1.0f : 0.0f, take_im = 1.0f - take_re;
+        float imag = complex_form ? (m < 0 ? -1.0f : 1.0f) : 0.0f;
+        for (size_t i = 0; i < lanes; ++i) {
+            float dpr = dp_re[i] * inv_r[i], dpi = dp_im[i] * inv_r[i];
+            float a_re = take_re * p_re[i] + take_im * p_im[i], a_im = imag * p_im[i];
+            float ax_re = take_re * dpr + take_im * dpi, ax_im = imag * dpi;
+            float ay_re = take_im * dpr - take_re * dpi, ay_im = imag * dpr;
+
+            float inv_r3 = inv_r[i] * inv_r[i] * inv_r[i];
+            float f = norm * g[i] * q[i];
+            float radial_part = norm * dg[i] * q[i] * inv_r[i], polar_part = norm * g[i] * dq[i] * inv_r3;
+            float fx = (radial_part - polar_part * z[i]) * x[i];
+            float fy = (radial_part - polar_part * z[i]) * y[i];
+            float fz = radial_part * z[i] + polar_part * (x[i] * x[i] + y[i] * y[i]);
+            out.psi_re[i] = f * a_re;
+            out.psi_im[i] = f * a_im;
+            out.grad_re[0][i] = fx * a_re + f * ax_re;
+            out.grad_im[0][i] = fx * a_im + f * ax_im;
+            out.grad_re[1][i] = fy * a_re + f * ay_re;
+            out.grad_im[1][i] = fy * a_im + f * ay_im;
+            out.grad_re[2][i] = fz * a_re;
+            out.grad_im[2][i] = fz * a_im;
+        }
+    }
+
+    float psi(float x, float y, float z) const {
+        float r = std::sqrt(x * x + y * y + z * z);
+        return radial(r) * angular(x, y, z, r);
+    }
+};
+
+void wavefunction_batch(const Orbital& orbital, const float* x, const float* y, const float* z, size_t count, float* out) {
+    OrbitalKernel kernel(orbital);
+    for (size_t i = 0; i < count; ++i)
+        out[i] = kernel.psi(x[i], y[i], z[i]);
+}
+
+void probability_density_batch(const Orbital& orbital, const float* x, const float* y, const float* z, size_t count, float time, float* out) {
+    float vibration = vibration_scale(time);
+    wavefunction_batch(orbital, x, y, z, count, out);
+    for (size_t i = 0; i < count; ++i)
+        out[i] = out[i] * out[i] * vibration;
+}
+
+// Total density of the current subshell, sum_m |psi_nlm|^2, or of the closed
+// shell n (closed_shell: every l < n as well). By the addition theorem
+// sum_m |Y_lm|^2 = (2l + 1) / 4pi, so the angular sum is a constant and each
+// point costs one radial evaluation per subshell instead of 2l + 1 full ones.
+void shell_density_batch(const Orbital& orbital, bool closed_shell, const float* x, const float* y, const float* z, size_t count,
+                         float time, float* out) {
+    float vibration = vibration_scale(time);
+    std::vector<OrbitalKernel> kernels;
+    std::vector<float> weights; // (2l + 1) / 4pi
+    for (int l = closed_shell ? 0 : orbital.l; l <= (closed_shell ? orbital.n - 1 : orbital.l); ++l) {
+        kernels.emplace_back(Orbital{orbital.n, l, 0, 1.0f, "", sf::Vector3f(), orbital.species});
+        weights.push_back((2.0f * l + 1.0f) / (4.0f * PI) * vibration);
+    }
+    for (size_t i = 0; i < count; ++i) {
+        float r = std::sqrt(x[i] * x[i] + y[i] * y[i] + z[i] * z[i]);
+        float density = 0.0f;
+        for (size_t k = 0; k < kernels.size(); ++k) {
+            float R = kernels[k].radial(r);
+            density += weights[k] * R * R;
+        }
+        out[i] = density;
+    }
+}
+
+// psi and grad psi in one pass, analytic derivatives of the radial and angular parts
+void wavefunction_gradient_batch(const Orbital& orbital, const float* x, const float* y, const float* z, size_t count,
+                                 float* psi, float* gx, float* gy, float* gz) {
+    OrbitalKernel kernel(orbital);
+    for (size_t i = 0; i < count; ++i) {
+        float grad[3];
+        psi[i] = kernel.real_gradient(x[i], y[i], z[i], grad);
+        gx[i] = grad[0];
+        gy[i] = grad[1];
+        gz[i] = grad[2];
+    }
+}
+
+// |psi|^2 and grad |psi|^2 = 2 psi grad psi
+void probability_density_gradient_batch(const Orbital& orbital, const float* x, const float* y, const float* z, size_t count,
+                                        float time, float* density, float* gx, float* gy, float* gz) {
+    float vibration = vibration_scale(time);
+    wavefunction_gradient_batch(orbital, x, y, z, count, density, gx, gy, gz);
+    for (size_t i = 0; i < count; ++i) {
+        float psi = density[i];
+        density[i] = psi * psi * vibration;
+        gx[i] *= 2.0f * psi * vibration;
+        gy[i] *= 2.0f * psi * vibration;
+        gz[i] *= 2.0f * psi * vibration;
+    }
+}
+
+// =======================
+// Orbital Point Generator
+// =======================
+
+// r is drawn from r^2 R_nl(r)^2 and theta from the polar factor of |Y_lm|^2
+// by inverting tabulated CDFs, and phi from the azimuthal factor by rejection
+// (acceptance 1/2). The tables span the whole range with a resolution that
+// grows with n and l, so a sample costs the same at any n.
+constexpr int RADIAL_CDF_BINS = 4096; // Minimum; 128 per unit of n beyond that
+constexpr int POLAR_CDF_BINS = 1024;  // Minimum; 64 per unit of l beyond that
+
+struct TabulatedCdf {
+    float extent = 0.0f;
+    std::vector<float> cdf; // cdf[i] = P(x < extent * i / bins), bins = cdf.size() - 1
+
+    float sample(float u) const {
+        size_t i = std::upper_bound(cdf.begin(), cdf.end(), u) - cdf.begin();
+        i = std::min(std::max<size_t>(i, 1), cdf.size() - 1);
+        float t = (u - cdf[i - 1]) / std::fmax(cdf[i] - cdf[i - 1], 1e-30f);
+        return extent * (i - 1 + t) / (cdf.size() - 1);
+    }
+
+    // P(x < value)
+    float mass_within(float value) const {
+        float f = value / extent * (cdf.size() - 1);
+        if (f >= cdf.size() - 1)
+            return 1.0f;
+        size_t i = static_cast<size_t>(f);
+        return cdf[i] + (f - i) * (cdf[i + 1] - cdf[i]);
+    }
+};
+
+// Trapezoid integral of density over [0, extent], normalized
+TabulatedCdf tabulate_cdf(float extent, int bins, const std::function<double(float)>& density) {
+    TabulatedCdf table;
+    table.extent = extent;
+    table.cdf.resize(bins + 1);
+    float dx = extent / bins;
+    double total = 0.0, previous = density(0.0f);
+    table.cdf[0] = 0.0f;
+    for (int i = 1; i <= bins; ++i) {
+        double current = density(i * dx);
+        total += 0.5 * (previous + current) * dx;
+        previous = current;
+        table.cdf[i] = static_cast<float>(total);
+    }
+    for (auto& c : table.cdf)
+        c = static_cast<float>(c / total);
+    return table;
+}
+
+// Comfortably past the outermost radial lobe (<r> is about 1.5 n^2 a0)
+float radial_table_extent(int n, float a0) {
+    return (4.0f * n * n + 8.0f * n + 12.0f) * a0;
+}
+
+// Cached per species, so switching species back and forth rebuilds nothing
+const TabulatedCdf& radial_cdf(int n, int l, const Species& species) {
+    static std::mutex mutex;
+    static std::map<std::tuple<int, int, int, float>, TabulatedCdf> cache;
+    std::lock_guard<std::mutex> lock(mutex);
+
+    auto key = std::make_tuple(n, l, species.charge, species.reduced_mass);
+    auto it = cache.find(key);
+    if (it != cache.end())
+        return it->second;
+
+    float a0 = species.bohr_radius();
+    TabulatedCdf table = tabulate_cdf(radial_table_extent(n, a0), std::max(RADIAL_CDF_BINS, 128 * n), [n, l, a0](float r) {
+        double R = radial_function(n, l, r, a0);
+        return r * r * R * R;
+    });
+    return cache.emplace(key, std::move(table)).first->second;
+}
+
+// CDF of theta under the polar factor of |Y_l,+-m|^2, m >= 0 (the same for every species)
+const TabulatedCdf& polar_cdf(int l, int m) {
+    static std::mutex mutex;
+    static std::map<std::pair<int, int>, TabulatedCdf> cache;
+    std::lock_guard<std::mutex> lock(mutex);
+
+    auto it = cache.find({l, m});
+    if (it != cache.end())
+        return it->second;
+
+    TabulatedCdf table = tabulate_cdf(PI, std::max(POLAR_CDF_BINS, 64 * l), [l, m](float theta) {
+        double P = real_harmonic_polar(l, m, theta);
+        return P * P * std::sin(theta);
+    });
+    return cache.emplace(std::make_pair(l, m), std::move(table)).first->second;
+}
+
+// Unit vector with density |Y_lm|^2 (real harmonic); complex_form draws from
+// |Y_lm|^2 of the e^{i m phi} form instead, where phi is uniform. polar is
+// polar_cdf(l, |m|), looked up once by the caller rather than per sample.
+sf::Vector3f sample_direction(const Orbital& orbital, const TabulatedCdf& polar, std::mt19937& gen, bool complex_form = false) {
+    std::uniform_real_distribution<float> unit_dist(0.0f, 1.0f);
+    std::uniform_real_distribution<float> phi_dist(0.0f, 2.0f * PI);
+    float theta = polar.sample(unit_dist(gen));
+    float phi = phi_dist(gen);
+    if (!complex_form && orbital.m != 0) {
+        // cos^2(m phi) or sin^2(|m| phi) is at most 1
+        float F = real_harmonic_azimuth(orbital.m, phi);
+        while (unit_dist(gen) >= F * F) {
+            phi = phi_dist(gen);
+            F = real_harmonic_azimuth(orbital.m, phi);
+        }
+    }
+    float sin_theta = std::sin(theta);
+    return sf::Vector3f(sin_theta * std::cos(phi), sin_theta * std::sin(phi), std::cos(theta));
+}
+
+// Bounding radius of the sampled cloud: holds all but 1e-4 of the probability
+float sampling_radius(const Orbital& orbital) {
+    return radial_cdf(orbital.n, orbital.l, orbital.species).sample(0.9999f);
+}
+
+// Largest radius the sampler can return: the end of the radial table
+float sampling_extent(const Orbital& orbital) {
+    return radial_cdf(orbital.n, orbital.l, orbital.species).extent;
+}
+
+// One exact sample of |psi|^2 (complex_form: of the e^{i m phi} form) from the
+// orbital's radial_cdf and polar_cdf tables
+sf::Vector3f sample_orbital_point(const Orbital& orbital, const TabulatedCdf& radial, const TabulatedCdf& polar, std::mt19937& gen,
+                                  bool complex_form = false) {
+    std::uniform_real_distribution<float> unit_dist(0.0f, 1.0f);
+    float r = radial.sample(unit_dist(gen));
+    sf::Vector3f d = sample_direction(orbital, polar, gen, complex_form);
+    return sf::Vector3f(r * d.x, r * d.y, r * d.z);
+}
+
+// Exact samples of |psi|^2: radius and direction drawn independently, so no
+// proposal is wasted however far out the orbital reaches. The vibration only
+// scales the density, so the distribution does not depend on time.
+std::vector<sf::Vector3f> generate_orbital_points(const Orbital& orbital, size_t count, std::mt19937& gen) {
+    const TabulatedCdf& radial = radial_cdf(orbital.n, orbital.l, orbital.species);
+    const TabulatedCdf& polar = polar_cdf(orbital.l, std::abs(orbital.m));
+    std::vector<sf::Vector3f> points;
+    points.reserve(count);
+    while (points.size() < count)
+        points.push_back(sample_orbital_point(orbital, radial, polar, gen));
+    return points;
+}
+
+// =======================
+// Orbital Symmetry Maps
+// =======================
+
+// Orbitals related by a rotation or axis permutation share one sampled cloud.
+// The canonical cloud is sampled once and drawn through q = matrix * p,
+// folded into the modelview matrix.
+struct SymmetryMap {
+    Orbital canonical;
+    float matrix[9]; // Row-major 3x3
+};
+
+void set_matrix(float* out, std::initializer_list<float> values) {
+    std::copy(values.begin(), values.end(), out);
+}
+
+// Rotation about z by angle
+void set_rotation_z(float* out, float angle) {
+    float c = std::cos(angle), s = std::sin(angle);
+    set_matrix(out, {c, -s, 0.0f, s, c, 0.0f, 0.0f, 0.0f, 1.0f});
+}
+
+void multiply_matrix(const float* a, const float* b, float* out) {
+    for (int i = 0; i < 3; ++i)
+        for (int j = 0; j < 3; ++j)
+            out[3 * i + j] = a[3 * i] * b[j] + a[3 * i + 1] * b[3 + j] + a[3 * i + 2] * b[6 + j];
+}
+
+// Exact maps between real harmonics (density only, the sign of psi is not kept):
+//  - m < 0 is m > 0 rotated about z by pi / (2|m|), for any l
+//  - px, py are pz with permuted axes
+//  - dyz, dxy are dxz with permuted axes, dx2-y2 is dxy rotated by -pi/4
+// f and higher only use the first rule, so they sample one cloud per (n, l, |m|).
+SymmetryMap symmetry_map(const Orbital& orbital) {
+    SymmetryMap map{orbital, {}};
+    set_matrix(map.matrix, {1.0f, 0.0f, 0.0f, 0.0f, 1.0f, 0.0f, 0.0f, 0.0f, 1.0f});
+    int l = orbital.l, m = orbital.m;
+
+    if (l == 1) {
+        map.canonical.m = 0; // pz
+        if (m == 1)  // (x, y, z) <- (z, x, y)
+            set_matrix(map.matrix, {0.0f, 0.0f, 1.0f, 1.0f, 0.0f, 0.0f, 0.0f, 1.0f, 0.0f});
+        if (m == -1) // (x, y, z) <- (y, z, x)
+            set_matrix(map.matrix, {0.0f, 1.0f, 0.0f, 0.0f, 0.0f, 1.0f, 1.0f, 0.0f, 0.0f});
+        return map;
+    }
+
+    if (l == 2 && m != 0) {
+        map.canonical.m = 1; // dxz
+        float swap_yz[9] = {1.0f, 0.0f, 0.0f, 0.0f, 0.0f, 1.0f, 0.0f, 1.0f, 0.0f};
+        if (m == -1)
+            set_rotation_z(map.matrix, PI / 2.0f);
+        if (m == -2)
+            std::copy(swap_yz, swap_yz + 9, map.matrix);
+        if (m == 2) {
+            float rotation[9];
+            set_rotation_z(rotation, -PI / 4.0f);
+            multiply_matrix(rotation, swap_yz, map.matrix);
+        }
+        return map;
+    }
+
+    if (m < 0) {
+        map.canonical.m = -m;
+        set_rotation_z(map.matrix, PI / (2.0f * -m));
+    }
+    return map;
+}
+
+bool same_symmetry_class(const Orbital& a, const Orbital& b) {
+    Orbital ca = symmetry_map(a).canonical, cb = symmetry_map(b).canonical;
+    return ca.n == cb.n && ca.l == cb.l && ca.m == cb.m && ca.species == cb.species;
+}
+
+// =======================
+// Subshell Batch Sampler
+// =======================
+
+// Returns count points for each m = -l..l (index m + l), sharing one set of radial draws
+std::vector<std::vector<sf::Vector3f>> generate_subshell_points(int n, int l, const Species& species, size_t count,
+                                                                std::mt19937& gen) {
+    const TabulatedCdf& cdf = radial_cdf(n, l, species);
+    std::uniform_real_distribution<float> unit_dist(0.0f, 1.0f);
+    std::vector<float> radii(count);
+    for (auto& r : radii)
+        r = cdf.sample(unit_dist(gen));
+
+    std::vector<std::vector<sf::Vector3f>> clouds(2 * l + 1);
+    for (int m = -l; m <= l; ++m) {
+        Orbital orbital{n, l, m, 1.0f, "", sf::Vector3f(), species};
+        const TabulatedCdf& polar = polar_cdf(l, std::abs(m));
+        auto& cloud = clouds[m + l];
+        cloud.reserve(count);
+        for (float r : radii) {
+            sf::Vector3f d = sample_direction(orbital, polar, gen);
+            cloud.emplace_back(r * d.x, r * d.y, r * d.z);
+        }
+    }
+    return clouds;
+}
+
+// Exact samples of the shell_density_batch density, which is spherically
+// symmetric: the subshell of a closed shell is picked with weight
+// (2l + 1) / n^2, r comes from its radial CDF and the direction is uniform.
+std::vector<sf::Vector3f> sample_shell(const Orbital& orbital, bool closed_shell, size_t count, std::mt19937& gen) {
+    std::vector<const TabulatedCdf*> cdfs;
+    std::vector<double> weights;
+    for (int l = closed_shell ? 0 : orbital.l; l <= (closed_shell ? orbital.n - 1 : orbital.l); ++l) {
+        cdfs.push_back(&radial_cdf(orbital.n, l, orbital.species));
+        weights.push_back(2.0 * l + 1.0);
+    }
+    std::discrete_distribution<size_t> pick(weights.begin(), weights.end());
+    std::uniform_real_distribution<float> unit_dist(0.0f, 1.0f);
+    std::uniform_real_distribution<float> cos_theta_dist(-1.0f, 1.0f);
+    std::uniform_real_distribution<float> phi_dist(0.0f, 2.0f * PI);
+    std::vector<sf::Vector3f> points;
+    points.reserve(count);
+    for (size_t i = 0; i < count; ++i) {
+        float r = cdfs[pick(gen)]->sample(unit_dist(gen));
+        float cos_theta = cos_theta_dist(gen);
+        float phi = phi_dist(gen);
+        float sin_theta = std::sqrt(std::fmax(0.0f, 1.0f - cos_theta * cos_theta));
+        points.emplace_back(r * sin_theta * std::cos(phi), r * sin_theta * std::sin(phi), r * cos_theta);
+    }
+    return points;
+}
+
+// =======================
+// Complex Orbitals
+// =======================
+
+// psi_nlm = R_nl N_l|m| P_l^|m|(cos theta) e^{i m phi} with the Condon-Shortley
+// phase, and Y_l,-|m| = (-1)^|m| conj(Y_l|m|). The e^{i m phi} factor comes
+// from the same rotation as the real kernel, so no trig is evaluated. Output
+// is |psi|^2 and the phase as a unit complex number (cos, sin); a zero psi
+// reports phase 1. Points go through radial_batch and angular_block a block
+// at a time, so every step but the per-point log and exp runs across lanes.
+void complex_wavefunction_batch(const Orbital& orbital, const float* x, const float* y, const float* z, size_t count,
+                                float* density, float* phase_re, float* phase_im) {
+    OrbitalKernel kernel(orbital);
+    float norm = kernel.complex_norm, conjugate = kernel.m < 0 ? -1.0f : 1.0f;
+    float r[KERNEL_LANES], radial[KERNEL_LANES], q[KERNEL_LANES], re[KERNEL_LANES], im[KERNEL_LANES];
+    for (size_t begin = 0; begin < count; begin += KERNEL_LANES) {
+        size_t lanes = std::min(KERNEL_LANES, count - begin);
+        const float *bx = x + begin, *by = y + begin, *bz = z + begin;
+        for (size_t i = 0; i < lanes; ++i)
+            r[i] = std::sqrt(bx[i] * bx[i] + by[i] * by[i] + bz[i] * bz[i]);
+        kernel.radial_batch(r, lanes, radial);
+        kernel.angular_block(bx, by, bz, r, lanes, q, re, im);
+        float *d = density + begin, *pr = phase_re + begin, *pi = phase_im + begin;
+        for (size_t i = 0; i < lanes; ++i) {
+            float amplitude = radial[i] * norm * q[i];
+            float psi_re = re[i] * amplitude, psi_im = conjugate * im[i] * amplitude;
+            d[i] = psi_re * psi_re + psi_im * psi_im;
+            float magnitude = std::sqrt(d[i]);
+            int nonzero = magnitude > 0.0f; // As in radial_batch, a flag instead of a select
+            float inv = nonzero / (magnitude + (1 - nonzero));
+            pr[i] = psi_re * inv + (1 - nonzero);
+            pi[i] = psi_im * inv;
+        }
+    }
+}
+
+// Hue wheel from a unit phase: three cosines 120 degrees apart, expanded so
+// the phase is only rotated, never converted to an angle
+sf::Vector3f phase_hue(float phase_re, float phase_im) {
+    constexpr float C = -0.5f, S = 0.8660254f; // cos and sin of 120 degrees
+    return sf::Vector3f(0.5f + 0.5f * phase_re,
+                        0.5f + 0.5f * (C * phase_re + S * phase_im),
+                        0.5f + 0.5f * (C * phase_re - S * phase_im));
+}
+
+// Exact samples of the complex |psi|^2, which does not depend on phi: the
+// radius and theta from the same tables as the real orbital, phi uniform
+std::vector<sf::Vector3f> sample_complex_orbital(const Orbital& orbital, size_t count, std::mt19937& gen) {
+    const TabulatedCdf& radial = radial_cdf(orbital.n, orbital.l, orbital.species);
+    const TabulatedCdf& polar = polar_cdf(orbital.l, std::abs(orbital.m));
+    std::vector<sf::Vector3f> points;
+    points.reserve(count);
+    while (points.size() < count)
+        points.push_back(sample_orbital_point(orbital, radial, polar, gen, true));
+    return points;
+}
+
+// =======================
+// Hybrid Orbitals
+// =======================
+
+enum class Hybridization { SP, SP2, SP3 };
+
+// Fixed linear combinations of basis orbitals:
+// hybrid h = sum_b coefficients[h * basis.size() + b] psi_b
+struct HybridSet {
+    std::vector<Orbital> basis;
+    std::vector<float> coefficients; // hybrids x basis, row-major
+
+    size_t count() const { return coefficients.size() / basis.size(); }
+};
+
+// The orthonormal sp (along z), sp2 (in the xy plane) and sp3 (tetrahedral)
+// hybrids of ns and np, written for basis functions whose outer radial lobe
+// is positive and which point along +x, +y, +z. R_nl's outer lobe has the
+// sign (-1)^(n-l-1), and the real m = +-1 harmonics carry the Condon-Shortley
+// sign (-x and -y), so the columns are flipped to match afterwards.
+HybridSet make_hybrids(int n, Hybridization kind, const Species& species) {
+    const float a = 1.0f / std::sqrt(2.0f), b = 1.0f / std::sqrt(3.0f), c = std::sqrt(2.0f / 3.0f), d = 1.0f / std::sqrt(6.0f);
+    Orbital s{n, 0, 0, 1.0f, "s", sf::Vector3f(), species};
+    Orbital px{n, 1, 1, 1.0f, "px", sf::Vector3f(), species};
+    Orbital py{n, 1, -1, 1.0f, "py", sf::Vector3f(), species};
+    Orbital pz{n, 1, 0, 1.0f, "pz", sf::Vector3f(), species};
+    HybridSet set;
+    switch (kind) {
+    case Hybridization::SP:
+        set.basis = {s, pz};
+        set.coefficients = {a, a,
+                            a, -a};
+        break;
+    case Hybridization::SP2:
+        set.basis = {s, px, py};
+        set.coefficients = {b, c, 0.0f,
+                            b, -d, a,
+                            b, -d, -a};
+        break;
+    case Hybridization::SP3:
+        set.basis = {s, px, py, pz};
+        set.coefficients = {0.5f, 0.5f, 0.5f, 0.5f,
+                            0.5f, 0.5f, -0.5f, -0.5f,
+                            0.5f, -0.5f, 0.5f, -0.5f,
+                            0.5f, -0.5f, -0.5f, 0.5f};
+        break;
+    }
+    size_t basis_count = set.basis.size();
+    for (size_t k = 0; k < basis_count; ++k) {
+        const Orbital& o = set.basis[k];
+        bool flip = (n - o.l - 1) % 2 != 0;
+        if (o.m != 0)
+            flip = !flip;
+        if (flip)
+            for (size_t h = 0; h < set.count(); ++h)
+                set.coefficients[h * basis_count + k] = -set.coefficients[h * basis_count + k];
+    }
+    return set;
+}
+
+constexpr size_t HYBRID_BLOCK = 256; // Points per block of basis values
+
+// Every hybrid at count points, out[h * count + i]. The basis is evaluated
+// once per point in one fused pass that shares r and computes one radial
+// per distinct (n, l); each block of basis values is then multiplied by the
+// coefficient matrix, a small GEMM whose inner loop runs over points.
+void hybrid_wavefunction_batch(const HybridSet& set, const float* x, const float* y, const float* z, size_t count, float* out) {
+    size_t basis_count = set.basis.size(), hybrid_count = set.count();
+    std::vector<OrbitalKernel> kernels;
+    std::vector<size_t> radial_of(basis_count); // First basis function with the same radial part
+    for (size_t k = 0; k < basis_count; ++k) {
+        const Orbital& o = set.basis[k];
+        kernels.emplace_back(o);
+        radial_of[k] = k;
+        for (size_t j = 0; j < k; ++j)
+            if (set.basis[j].n == o.n && set.basis[j].l == o.l && set.basis[j].species == o.species) {
+                radial_of[k] = j;
+                break;
+            }
+    }
+
+    std::vector<float> values(basis_count * HYBRID_BLOCK), radial(basis_count);
+    for (size_t begin = 0; begin < count; begin += HYBRID_BLOCK) {
+        size_t block = std::min(HYBRID_BLOCK, count - begin);
+        for (size_t i = 0; i < block; ++i) {
+            float px = x[begin + i], py = y[begin + i], pz = z[begin + i];
+            float r = std::sqrt(px * px + py * py + pz * pz);
+            for (size_t k = 0; k < basis_count; ++k) {
+                radial[k] = radial_of[k] == k ? kernels[k].radial(r) : radial[radial_of[k]];
+                values[k * HYBRID_BLOCK + i] = radial[k] * kernels[k].angular(px, py, pz, r);
+            }
+        }
+        for (size_t h = 0; h < hybrid_count; ++h) {
+            float* row = out + h * count + begin;
+            std::fill(row, row + block, 0.0f);
+            for (size_t k = 0; k < basis_count; ++k) {
+                float c = set.coefficients[h * basis_count + k];
+                const float* column = &values[k * HYBRID_BLOCK];
+                if (c != 0.0f)
+                    for (size_t i = 0; i < block; ++i)
+                        row[i] += c * column[i];
+            }
+        }
+    }
+}
+
+// Points of every hybrid, clouds[h]. Draws come from the basis mixture
+// (1/N) sum_b psi_b^2, which equals (1/N) sum_h psi_h^2 because the
+// coefficient matrix is orthogonal. Each point goes to hybrid h with
+// probability psi_h^2 / sum psi^2, so the points of hybrid h are exact
+// samples of psi_h^2, about count / N of them.
+std::vector<std::vector<sf::Vector3f>> sample_hybrids(const HybridSet& set, size_t count, std::mt19937& gen) {
+    size_t basis_count = set.basis.size(), hybrid_count = set.count();
+    std::vector<size_t> per_basis(basis_count, 0);
+    std::uniform_int_distribution<size_t> pick(0, basis_count - 1);
+    for (size_t i = 0; i < count; ++i)
+        ++per_basis[pick(gen)];
+
+    std::vector<float> x, y, z;
+    x.reserve(count);
+    y.reserve(count);
+    z.reserve(count);
+    for (size_t k = 0; k < basis_count; ++k)
+        for (const sf::Vector3f& p : generate_orbital_points(set.basis[k], per_basis[k], gen)) {
+            x.push_back(p.x);
+            y.push_back(p.y);
+            z.push_back(p.z);
+        }
+    std::vector<float> values(hybrid_count * count);
+    hybrid_wavefunction_batch(set, x.data(), y.data(), z.data(), count, values.data());
+
+    std::uniform_real_distribution<float> unit_dist(0.0f, 1.0f);
+    std::vector<std::vector<sf::Vector3f>> clouds(hybrid_count);
+    for (size_t i = 0; i < count; ++i) {
+        float total = 0.0f;
+        for (size_t h = 0; h < hybrid_count; ++h)
+            total += values[h * count + i] * values[h * count + i];
+        float u = unit_dist(gen) * total;
+        size_t h = 0;
+        float sum = values[i] * values[i];
+        while (sum <= u && h + 1 < hybrid_count) {
+            ++h;
+            sum += values[h * count + i] * values[h * count + i];
+        }
+        clouds[h].emplace_back(x[i], y[i], z[i]);
+    }
+    return clouds;
+}
+
+// =======================
+// Molecular Orbitals
+// =======================
+
+constexpr float MOLECULAR_TOLERANCE = 1e-6f; // Atomic probability past a center's cutoff radius
+constexpr int OVERLAP_SAMPLES = 1 << 17;
+constexpr size_t MOLECULAR_BLOCK = 4096; // Proposals per rejection round
+
+// Two-center LCAO orbital of a one-electron homonuclear ion (H2+ for
+// hydrogen): psi = N (phi_A + s phi_B), with the same atomic orbital on
+// nuclei A and B at z = -bond_length / 2 and +bond_length / 2. 1s and 2pz
+// give sigma orbitals, 2px and 2py pi orbitals.
+struct MolecularOrbital {
+    Orbital atomic;
+    float bond_length = 2.0f * BOHR_RADIUS;
+    bool bonding = true;
+
+    // s: phi_B's sign. Under z -> -z the real orbital picks up (-1)^(l+|m|),
+    // so for p sigma the bonding combination is phi_A - phi_B.
+    float partner_sign() const {
+        float sign = (atomic.l + std::abs(atomic.m)) % 2 ? -1.0f : 1.0f;
+        return bonding ? sign : -sign;
+    }
+};
+
+// phi_A and phi_B at count points in one pass, sharing the kernel and x, y.
+// A center is skipped past the radius holding all but MOLECULAR_TOLERANCE of
+// its atomic probability, and contributes zero there.
+void molecular_center_batch(const MolecularOrbital& mo, const float* x, const float* y, const float* z, size_t count,
+                            float* phi_a, float* phi_b) {
+    OrbitalKernel kernel(mo.atomic);
+    float cutoff = radial_cdf(mo.atomic.n, mo.atomic.l, mo.atomic.species).sample(1.0f - MOLECULAR_TOLERANCE);
+    float cutoff2 = cutoff * cutoff, half = 0.5f * mo.bond_length;
+    for (size_t i = 0; i < count; ++i) {
+        float rho2 = x[i] * x[i] + y[i] * y[i];
+        float za = z[i] + half, zb = z[i] - half;
+        phi_a[i] = rho2 + za * za < cutoff2 ? kernel.psi(x[i], y[i], za) : 0.0f;
+        phi_b[i] = rho2 + zb * zb < cutoff2 ? kernel.psi(x[i], y[i], zb) : 0.0f;
+    }
+}
+
+// Draws from the mixture q = (phi_A^2 + phi_B^2) / 2: an exact atomic sample
+// around a center picked with probability 1/2. The center is drawn per
+// proposal, so any prefix of the block is still a sample of q.
+void molecular_proposals(const MolecularOrbital& mo, size_t count, std::mt19937& gen, float* x, float* y, float* z) {
+    std::bernoulli_distribution pick_b(0.5);
+    std::vector<sf::Vector3f> points = generate_orbital_points(mo.atomic, count, gen);
+    float half = 0.5f * mo.bond_length;
+    for (size_t i = 0; i < count; ++i) {
+        x[i] = points[i].x;
+        y[i] = points[i].y;
+        z[i] = points[i].z + (pick_b(gen) ? half : -half);
+    }
+}
+
+// Overlap S = <phi_A|phi_B>, estimated as the mean of phi_A phi_B / q over
+// mixture samples; the ratio is bounded by 1. Cached per orbital, species
+// and bond length.
+float molecular_overlap(const MolecularOrbital& mo) {
+    static std::mutex mutex;
+    static std::map<std::tuple<int, int, int, int, float, float>, float> cache;
+    const Orbital& o = mo.atomic;
+    auto key = std::make_tuple(o.n, o.l, o.m, o.species.charge, o.species.reduced_mass, mo.bond_length);
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        auto it = cache.find(key);
+        if (it != cache.end())
+            return it->second;
+    }
+
+    std::mt19937 gen(4242);
+    std::vector<float> x(OVERLAP_SAMPLES), y(OVERLAP_SAMPLES), z(OVERLAP_SAMPLES), phi_a(OVERLAP_SAMPLES), phi_b(OVERLAP_SAMPLES);
+    molecular_proposals(mo, OVERLAP_SAMPLES, gen, x.data(), y.data(), z.data());
+    molecular_center_batch(mo, x.data(), y.data(), z.data(), OVERLAP_SAMPLES, phi_a.data(), phi_b.data());
+    double sum = 0.0;
+    for (int i = 0; i < OVERLAP_SAMPLES; ++i) {
+        float q = 0.5f * (phi_a[i] * phi_a[i] + phi_b[i] * phi_b[i]);
+        if (q > 0.0f)
+            sum += phi_a[i] * phi_b[i] / q;
+    }
+    float overlap = static_cast<float>(sum / OVERLAP_SAMPLES);
+
+    std::lock_guard<std::mutex> lock(mutex);
+    return cache.emplace(key, overlap).first->second;
+}
+
+// psi = N (phi_A + s phi_B) with N = 1 / sqrt(2 (1 + s S))
+void molecular_wavefunction_batch(const MolecularOrbital& mo, const float* x, const float* y, const float* z, size_t count, float* out) {
+    float sign = mo.partner_sign();
+    float norm = 1.0f / std::sqrt(2.0f * (1.0f + sign * molecular_overlap(mo)));
+    std::vector<float> phi_b(count);
+    molecular_center_batch(mo, x, y, z, count, out, phi_b.data());
+    for (size_t i = 0; i < count; ++i)
+        out[i] = norm * (out[i] + sign * phi_b[i]);
+}
+
+// Exact samples of |psi|^2 by rejection from the mixture:
+// |psi|^2 = N^2 (phi_A + s phi_B)^2 <= 2 N^2 (phi_A^2 + phi_B^2) = 4 N^2 q,
+// so a proposal is kept with probability (phi_A + s phi_B)^2 / 2 (phi_A^2 + phi_B^2),
+// which needs neither N nor S. The acceptance is (1 + s S) / 2, which is only
+// small when s S is near -1, i.e. the nuclei are close compared with the
+// orbital's size.
+std::vector<sf::Vector3f> sample_molecular_orbital(const MolecularOrbital& mo, size_t count, std::mt19937& gen) {
+    float sign = mo.partner_sign();
+    std::uniform_real_distribution<float> unit_dist(0.0f, 1.0f);
+    std::vector<float> x(MOLECULAR_BLOCK), y(MOLECULAR_BLOCK), z(MOLECULAR_BLOCK), phi_a(MOLECULAR_BLOCK), phi_b(MOLECULAR_BLOCK);
+    std::vector<sf::Vector3f> points;
+    points.reserve(count);
+    while (points.size() < count) {
+        molecular_proposals(mo, MOLECULAR_BLOCK, gen, x.data(), y.data(), z.data());
+        molecular_center_batch(mo, x.data(), y.data(), z.data(), MOLECULAR_BLOCK, phi_a.data(), phi_b.data());
+        for (size_t i = 0; i < MOLECULAR_BLOCK && points.size() < count; ++i) {
+            float combined = phi_a[i] + sign * phi_b[i];
+            float bound = 2.0f * (phi_a[i] * phi_a[i] + phi_b[i] * phi_b[i]);
+            if (unit_dist(gen) * bound < combined * combined)
+                points.emplace_back(x[i], y[i], z[i]);
+        }
+    }
+    return points;
+}
+
+// =======================
+// Parallel Helpers
+// =======================
+
+// Persistent worker pool shared by the grid builders and renderers
+class ThreadPool {
+public:
+    static ThreadPool& instance() {
+        static ThreadPool pool;
+        return pool;
+    }
+
+    size_t size() const { return workers_.size() + 1; }
+
+    // Calls fn(begin, end) on blocks of at most grain items; the caller joins in.
+    // Nested calls from inside a job run serially on the calling thread.
+    void parallel_for(size_t count, size_t grain, const std::function<void(size_t, size_t)>& fn) {
+        grain = std::max<size_t>(grain, 1);
+        if (count <= grain || workers_.empty() || inside_job()) {
+            for (size_t begin = 0; begin < count; begin += grain)
+                fn(begin, std::min(begin + grain, count));
+            return;
+        }
+
+        std::lock_guard<std::mutex> submit(submit_mutex_);
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            job_ = &fn;
+            count_ = count;
+            grain_ = grain;
+            next_ = 0;
+            busy_ = workers_.size();
+            ++generation_;
+        }
+        wake_.notify_all();
+        run_blocks(fn, count, grain);
+
+        std::unique_lock<std::mutex> lock(mutex_);
+        done_.wait(lock, [this]() { return busy_ == 0; });
+        job_ = nullptr;
+    }
+
+    ~ThreadPool() {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            stop_ = true;
+        }
+        wake_.notify_all();
+        for (auto& worker : workers_)
+            worker.join();
+    }
+
+private:
+    ThreadPool() {
+        unsigned threads = std::max(1u, std::thread::hardware_concurrency());
+        for (unsigned i = 1; i < threads; ++i)
+            workers_.emplace_back([this]() { worker_loop(); });
+    }
+
+    static bool& inside_job() {
+        thread_local bool inside = false;
+        return inside;
+    }
+
+    void run_blocks(const std::function<void(size_t, size_t)>& fn, size_t count, size_t grain) {
+        inside_job() = true;
+        for (size_t begin = next_.fetch_add(grain); begin < count; begin = next_.fetch_add(grain))
+            fn(begin, std::min(begin + grain, count));
+        inside_job() = false;
+    }
+
+    void worker_loop() {
+        size_t seen = 0;
+        while (true) {
+            std::unique_lock<std::mutex> lock(mutex_);
+            wake_.wait(lock, [&]() { return stop_ || generation_ != seen; });
+            if (stop_)
+                return;
+            seen = generation_;
+            const auto* fn = job_;
+            size_t count = count_, grain = grain_;
+            lock.unlock();
+
+            run_blocks(*fn, count, grain);
+
+            lock.lock();
+            if (--busy_ == 0)
+                done_.notify_one();
+        }
+    }
+
+    std::vector<std::thread> workers_;
+    std::mutex submit_mutex_;
+    std::mutex mutex_;
+    std::condition_variable wake_;
+    std::condition_variable done_;
+    const std::function<void(size_t, size_t)>* job_ = nullptr;
+    size_t count_ = 0, grain_ = 1, busy_ = 0, generation_ = 0;
+    std::atomic<size_t> next_{0};
+    bool stop_ = false;
+};
+
+void parallel_for(size_t count, size_t grain, const std::function<void(size_t, size_t)>& fn) {
+    ThreadPool::instance().parallel_for(count, grain, fn);
+}
+
+// =======================
+// Spherical Density Volume
+// =======================
+
+// |psi|^2 on a regular (r, theta, phi) grid. psi = R_nl(r) Y_lm(theta, phi) is
+// separable, so R^2 is evaluated once per shell and Y^2 once per direction
+// (itself a product of a theta and a phi table); the volume is their outer product.
+struct SphericalVolume {
+    int nr = 0, ntheta = 0, nphi = 0;
+    float r_max = 0.0f;
+    std::vector<float> values; // Index (ir * ntheta + itheta) * nphi + iphi
+
+    float at(int ir, int itheta, int iphi) const {
+        return values[(static_cast<size_t>(ir) * ntheta + itheta) * nphi + iphi];
+    }
+
+    // Trilinear lookup; phi wraps around
+    float sample(float r, float theta, float phi) const {
+        float fr = r / r_max * (nr - 1);
+        if (fr < 0.0f || fr >= nr - 1)
+            return 0.0f;
+        float ft = std::fmin(std::fmax(theta / PI * (ntheta - 1), 0.0f), ntheta - 1.001f);
+        float fp = phi / (2.0f * PI) * nphi;
+        fp -= std::floor(fp / nphi) * nphi;
+        int ir = static_cast<int>(fr), it = static_cast<int>(ft), ip = static_cast<int>(fp) % nphi;
+        int ip1 = (ip + 1) % nphi;
+        float tr = fr - ir, tt = ft - it, tp = fp - std::floor(fp);
+        float result = 0.0f;
+        for (int a = 0; a < 2; ++a)
+            for (int b = 0; b < 2; ++b) {
+                float w = (a ? tr : 1.0f - tr) * (b ? tt : 1.0f - tt);
+                result += w * ((1.0f - tp) * at(ir + a, it + b, ip) + tp * at(ir + a, it + b, ip1));
+            }
+        return result;
+    }
+};
+
+constexpr size_t VOLUME_TILE = 16384; // Angular entries per cache block (64 KB)
+
+SphericalVolume build_spherical_volume(const Orbital& orbital, int nr, int ntheta, int nphi, float r_max, float time) {
+    SphericalVolume volume;
+    volume.nr = nr;
+    volume.ntheta = ntheta;
+    volume.nphi = nphi;
+    volume.r_max = r_max;
+
+    float vibration = vibration_scale(time);
+    std::vector<float> radial(nr), polar(ntheta), azimuth(nphi);
+    float a0 = orbital.species.bohr_radius();
+    for (int i = 0; i < nr; ++i) {
+        float R = radial_function(orbital.n, orbital.l, r_max * i / (nr - 1), a0);
+        radial[i] = R * R * vibration;
+    }
+    for (int j = 0; j < ntheta; ++j) {
+        float P = real_harmonic_polar(orbital.l, orbital.m, PI * j / (ntheta - 1));
+        polar[j] = P * P;
+    }
+    for (int k = 0; k < nphi; ++k) {
+        float F = real_harmonic_azimuth(orbital.m, 2.0f * PI * k / nphi);
+        azimuth[k] = F * F;
+    }
+
+    size_t directions = static_cast<size_t>(ntheta) * nphi;
+    std::vector<float> angular(directions);
+    parallel_for(ntheta, 16, [&](size_t begin, size_t end) {
+        for (size_t j = begin; j < end; ++j)
+            for (int k = 0; k < nphi; ++k)
+                angular[j * nphi + k] = polar[j] * azimuth[k];
+    });
+
+    // Blocks of shells x angular tiles: each tile is reused from cache across the block
+    volume.values.resize(directions * nr);
+    constexpr size_t SHELLS_PER_BLOCK = 8;
+    size_t shell_blocks = (nr + SHELLS_PER_BLOCK - 1) / SHELLS_PER_BLOCK;
+    parallel_for(shell_blocks, 1, [&](size_t begin, size_t end) {
+        for (size_t block = begin; block < end; ++block) {
+            size_t first = block * SHELLS_PER_BLOCK;
+            size_t last = std::min(first + SHELLS_PER_BLOCK, static_cast<size_t>(nr));
+            for (size_t tile = 0; tile < directions; tile += VOLUME_TILE) {
+                size_t tile_end = std::min(tile + VOLUME_TILE, directions);
+                for (size_t i = first; i < last; ++i) {
+                    float R2 = radial[i];
+                    float* out = volume.values.data() + i * directions;
+                    for (size_t d = tile; d < tile_end; ++d)
+                        out[d] = R2 * angular[d];
+                }
+            }
+        }
+    });
+    return volume;
+}
+
+
+// =======================
+// Cartesian Density Grid
+// =======================
+
+// Axis-aligned voxel grid; values are stored at voxel centers, x fastest
+struct DensityGrid {
+    int nx = 0, ny = 0, nz = 0;
+    sf::Vector3f origin;  // Center of voxel (0, 0, 0)
+    sf::Vector3f spacing; // Voxel size per axis
+    std::vector<float> values;
+
+    size_t index(int i, int j, int k) const {
+        return (static_cast<size_t>(k) * ny + j) * nx + i;
+    }
+
+    float at(int i, int j, int k) const { return values[index(i, j, k)]; }
+
+    sf::Vector3f position(int i, int j, int k) const {
+        return sf::Vector3f(origin.x + i * spacing.x, origin.y + j * spacing.y, origin.z + k * spacing.z);
+    }
+
+    // Trilinear interpolation, zero outside the grid
+    float sample(float x, float y, float z) const {
+        float fx = (x - origin.x) / spacing.x, fy = (y - origin.y) / spacing.y, fz = (z - origin.z) / spacing.z;
+        if (fx < 0.0f || fy < 0.0f || fz < 0.0f || fx >= nx - 1 || fy >= ny - 1 || fz >= nz - 1)
+            return 0.0f;
+        int i = static_cast<int>(fx), j = static_cast<int>(fy), k = static_cast<int>(fz);
+        float tx = fx - i, ty = fy - j, tz = fz - k;
+        const float* v = &values[index(i, j, k)];
+        size_t sy = nx, sz = static_cast<size_t>(nx) * ny;
+        float c00 = v[0] + tx * (v[1] - v[0]);
+        float c10 = v[sy] + tx * (v[sy + 1] - v[sy]);
+        float c01 = v[sz] + tx * (v[sz + 1] - v[sz]);
+        float c11 = v[sz + sy] + tx * (v[sz + sy + 1] - v[sz + sy]);
+        float c0 = c00 + ty * (c10 - c00);
+        float c1 = c01 + ty * (c11 - c01);
+        return c0 + tz * (c1 - c0);
+    }
+};
+
+// Sign of psi under x -> -x, y -> -y and z -> -z for a real orbital.
+// |psi|^2 is even under all three, which is what the voxelizer exploits.
+void orbital_parity(const Orbital& orbital, int& px, int& py, int& pz) {
+    int am = std::abs(orbital.m);
+    int odd_x = orbital.m >= 0 ? am % 2 : (am + 1) % 2;
+    px = odd_x ? -1 : 1;
+    py = orbital.m < 0 ? -1 : 1;
+    pz = (orbital.l + am) % 2 ? -1 : 1;
+}
+
+// Voxelizes |psi|^2 (or the signed psi) over the cube [-half_extent, half_extent]^3.
+// Voxel centers are placed symmetrically about the nucleus, so only the octant
+// x, y, z >= 0 is evaluated and the other seven are mirrored from it.
+DensityGrid voxelize_orbital(const Orbital& orbital, int resolution, float half_extent, float time, bool signed_psi = false) {
+    DensityGrid grid;
+    grid.nx = grid.ny = grid.nz = resolution;
+    float h = 2.0f * half_extent / resolution;
+    grid.spacing = sf::Vector3f(h, h, h);
+    float first = -half_extent + 0.5f * h;
+    grid.origin = sf::Vector3f(first, first, first);
+    grid.values.resize(static_cast<size_t>(resolution) * resolution * resolution);
+
+    int px, py, pz;
+    orbital_parity(orbital, px, py, pz);
+    if (!signed_psi)
+        px = py = pz = 1;
+    float vibration = vibration_scale(time);
+
+    // Octant rows (j, k) in tiles; each row is one batch of the density kernel
+    int half = resolution / 2;   // First index with a non-negative coordinate
+    int octant = resolution - half;
+    parallel_for(static_cast<size_t>(octant) * octant, 8, [&](size_t begin, size_t end) {
+        std::vector<float> x(octant), y(octant), z(octant), psi(octant);
+        for (size_t row = begin; row < end; ++row) {
+            int j = half + static_cast<int>(row % octant);
+            int k = half + static_cast<int>(row / octant);
+            for (int a = 0; a < octant; ++a) {
+                x[a] = first + (half + a) * h;
+                y[a] = first + j * h;
+                z[a] = first + k * h;
+            }
+            wavefunction_batch(orbital, x.data(), y.data(), z.data(), octant, psi.data());
+
+            int mj = resolution - 1 - j, mk = resolution - 1 - k;
+            for (int a = 0; a < octant; ++a) {
+                float v = signed_psi ? psi[a] : psi[a] * psi[a] * vibration;
+                int i = half + a, mi = resolution - 1 - i;
+                grid.values[grid.index(i, j, k)] = v;
+                grid.values[grid.index(mi, j, k)] = px * v;
+                grid.values[grid.index(i, mj, k)] = py * v;
+                grid.values[grid.index(mi, mj, k)] = px * py * v;
+                grid.values[grid.index(i, j, mk)] = pz * v;
+                grid.values[grid.index(mi, j, mk)] = px * pz * v;
+                grid.values[grid.index(i, mj, mk)] = py * pz * v;
+                grid.values[grid.index(mi, mj, mk)] = px * py * pz * v;
+            }
+        }
+    });
+    return grid;
+}
+
+// =======================
+// Isosurface Extraction
+// =======================
+
+// Triangle mesh of an isosurface; phase is the sign of psi at each vertex
+struct Mesh {
+    std::vector<sf::Vector3f> vertices;
+    std::vector<sf::Vector3f> normals;  // Outward unit normals, empty if not computed
+    std::vector<std::int8_t> phase;
+    std::vector<std::uint32_t> indices; // Three per triangle
+};
+
+// Lattice edge directions. Each cell is split into six tetrahedra along its main
+// diagonal (Kuhn triangulation), so every tetrahedron edge is one of these seven
+// offsets from its lower corner, and neighbouring cells agree on shared faces.
+const int LATTICE_EDGES[7][3] = {{1, 0, 0}, {0, 1, 0}, {0, 0, 1}, {1, 1, 0}, {1, 0, 1}, {0, 1, 1}, {1, 1, 1}};
+
+int lattice_edge(int dx, int dy, int dz) {
+    for (int e = 0; e < 7; ++e)
+        if (LATTICE_EDGES[e][0] == dx && LATTICE_EDGES[e][1] == dy && LATTICE_EDGES[e][2] == dz)
+            return e;
+    return -1;
+}
+
+// Number of crossing edges in a mask (portable popcount)
+int edge_count(unsigned mask) {
+    int count = 0;
+    for (; mask; mask &= mask - 1)
+        ++count;
+    return count;
+}
+
+// Marching cells over the grid in parallel z-slabs. Every crossing edge belongs to
+// the lattice vertex at its lower end, so vertex indices come from a per-vertex
+// edge mask plus a prefix sum: shared vertices are deduplicated without locks.
+Mesh extract_isosurface(const DensityGrid& grid, float isovalue, const Orbital& orbital) {
+    Mesh mesh;
+    int nx = grid.nx, ny = grid.ny, nz = grid.nz;
+    if (nx < 2 || ny < 2 || nz < 2)
+        return mesh;
+
+    std::vector<std::uint8_t> above(grid.values.size());
+    parallel_for(above.size(), 1 << 16, [&](size_t begin, size_t end) {
+        for (size_t v = begin; v < end; ++v)
+            above[v] = grid.values[v] > isovalue;
+    });
+    auto inside = [&](int i, int j, int k) { return above[grid.index(i, j, k)] != 0; };
+
+    // Pass 1: crossing-edge masks and per-slab vertex counts
+    std::vector<std::uint8_t> masks(grid.values.size());
+    std::vector<std::uint32_t> slab_vertices(nz + 1, 0);
+    parallel_for(nz, 1, [&](size_t begin, size_t end) {
+        for (int k = static_cast<int>(begin); k < static_cast<int>(end); ++k) {
+            std::uint32_t count = 0;
+            for (int j = 0; j < ny; ++j)
+                for (int i = 0; i < nx; ++i) {
+                    bool a = inside(i, j, k);
+                    std::uint8_t mask = 0;
+                    for (int e = 0; e < 7; ++e) {
+                        int i2 = i + LATTICE_EDGES[e][0], j2 = j + LATTICE_EDGES[e][1], k2 = k + LATTICE_EDGES[e][2];
+                        if (i2 < nx && j2 < ny && k2 < nz && inside(i2, j2, k2) != a)
+                            mask |= 1 << e;
+                    }
+                    masks[grid.index(i, j, k)] = mask;
+                    count += edge_count(mask);
+                }
+            slab_vertices[k + 1] = count;
+        }
+    });
+    for (int k = 0; k < nz; ++k)
+        slab_vertices[k + 1] += slab_vertices[k];
+
+    // Pass 2: vertex positions and phases, written to disjoint ranges per slab
+    std::vector<std::uint32_t> first_vertex(grid.values.size());
+    mesh.vertices.resize(slab_vertices[nz]);
+    mesh.phase.resize(slab_vertices[nz]);
+    OrbitalKernel kernel(orbital);
+    parallel_for(nz, 1, [&](size_t begin, size_t end) {
+        for (int k = static_cast<int>(begin); k < static_cast<int>(end); ++k) {
+            std::uint32_t next = slab_vertices[k];
+            for (int j = 0; j < ny; ++j)
+                for (int i = 0; i < nx; ++i) {
+                    size_t v = grid.index(i, j, k);
+                    first_vertex[v] = next;
+                    for (int e = 0; e < 7; ++e) {
+                        if (!(masks[v] & (1 << e)))
+                            continue;
+                        int i2 = i + LATTICE_EDGES[e][0], j2 = j + LATTICE_EDGES[e][1], k2 = k + LATTICE_EDGES[e][2];
+                        float v0 = grid.at(i, j, k), v1 = grid.at(i2, j2, k2);
+                        float t = (isovalue - v0) / (v1 - v0);
+                        sf::Vector3f p0 = grid.position(i, j, k), p1 = grid.position(i2, j2, k2);
+                        sf::Vector3f p(p0.x + t * (p1.x - p0.x), p0.y + t * (p1.y - p0.y), p0.z + t * (p1.z - p0.z));
+                        mesh.vertices[next] = p;
+                        mesh.phase[next] = kernel.psi(p.x, p.y, p.z) >= 0.0f ? 1 : -1;
+                        ++next;
+                    }
+                }
+        }
+    });
+
+    auto edge_vertex = [&](int i, int j, int k, int e) {
+        size_t v = grid.index(i, j, k);
+        return first_vertex[v] + edge_count(masks[v] & ((1u << e) - 1u));
+    };
+
+    // Pass 3: triangles per slab of cells, concatenated afterwards
+    const int AXIS_ORDERS[6][3] = {{0, 1, 2}, {0, 2, 1}, {1, 0, 2}, {1, 2, 0}, {2, 0, 1}, {2, 1, 0}};
+    std::vector<std::vector<std::uint32_t>> slab_indices(nz - 1);
+    parallel_for(nz - 1, 1, [&](size_t begin, size_t end) {
+        for (int k = static_cast<int>(begin); k < static_cast<int>(end); ++k) {
+            auto& out = slab_indices[k];
+            for (int j = 0; j < ny - 1; ++j)
+                for (int i = 0; i < nx - 1; ++i) {
+                    int cell_inside = 0;
+                    for (int c = 0; c < 8; ++c)
+                        cell_inside += inside(i + (c & 1), j + ((c >> 1) & 1), k + (c >> 2));
+                    if (cell_inside == 0 || cell_inside == 8)
+                        continue;
+
+                    for (const auto& order : AXIS_ORDERS) {
+                        // Tetrahedron corners: walk from (0,0,0) to (1,1,1) one axis at a time
+                        int corner[4][3] = {{0, 0, 0}};
+                        for (int c = 1; c < 4; ++c) {
+                            std::copy(corner[c - 1], corner[c - 1] + 3, corner[c]);
+                            corner[c][order[c - 1]] = 1;
+                        }
+                        bool in[4];
+                        int count = 0;
+                        for (int c = 0; c < 4; ++c) {
+                            in[c] = inside(i + corner[c][0], j + corner[c][1], k + corner[c][2]);
+                            count += in[c];
+                        }
+                        if (count == 0 || count == 4)
+                            continue;
+
+                        // Crossing edges, ordered around the inside/outside split
+                        auto crossing = [&](int a, int b) {
+                            return edge_vertex(i + corner[a][0], j + corner[a][1], k + corner[a][2],
+                                               lattice_edge(corner[b][0] - corner[a][0], corner[b][1] - corner[a][1],
+                                                            corner[b][2] - corner[a][2]));
+                        };
+                        int ins[4], outs[4], in_count = 0, out_count = 0;
+                        for (int c = 0; c < 4; ++c) {
+                            if (in[c])
+                                ins[in_count++] = c;
+                            else
+                                outs[out_count++] = c;
+                        }
+                        // Corners are ordered along the diagonal, so (min, max) is always (lower, upper)
+                        auto edge = [&](int a, int b) { return crossing(std::min(a, b), std::max(a, b)); };
+
+                        // Triangles as corner-index pairs (one per crossing edge)
+                        int tri[2][3][2];
+                        int triangles = 1;
+                        if (in_count == 1 || out_count == 1) {
+                            const int* lone = in_count == 1 ? ins : outs;
+                            const int* rest = in_count == 1 ? outs : ins;
+                            for (int t = 0; t < 3; ++t)
+                                tri[0][t][0] = lone[0], tri[0][t][1] = rest[t];
+                        } else {
+                            int q[4][2] = {{ins[0], outs[0]}, {ins[0], outs[1]}, {ins[1], outs[1]}, {ins[1], outs[0]}};
+                            for (int t = 0; t < 3; ++t) {
+                                std::copy(q[t], q[t] + 2, tri[0][t]);
+                                std::copy(q[t == 0 ? 0 : t + 1], q[t == 0 ? 0 : t + 1] + 2, tri[1][t]);
+                            }
+                            triangles = 2;
+                        }
+
+                        // Orient each triangle to face from the inside corners to the outside ones.
+                        // Edge midpoints give the same orientation as the interpolated vertices
+                        // but never degenerate.
+                        float outward[3] = {0.0f, 0.0f, 0.0f};
+                        for (int c = 0; c < 4; ++c)
+                            for (int a = 0; a < 3; ++a)
+                                outward[a] += corner[c][a] * (in[c] ? -1.0f / in_count : 1.0f / out_count);
+                        for (int t = 0; t < triangles; ++t) {
+                            float mid[3][3];
+                            for (int v = 0; v < 3; ++v)
+                                for (int a = 0; a < 3; ++a)
+                                    mid[v][a] = 0.5f * (corner[tri[t][v][0]][a] + corner[tri[t][v][1]][a]);
+                            float u[3], w[3];
+                            for (int a = 0; a < 3; ++a)
+                                u[a] = mid[1][a] - mid[0][a], w[a] = mid[2][a] - mid[0][a];
+                            float normal[3] = {u[1] * w[2] - u[2] * w[1], u[2] * w[0] - u[0] * w[2], u[0] * w[1] - u[1] * w[0]};
+                            bool flip = normal[0] * outward[0] + normal[1] * outward[1] + normal[2] * outward[2] < 0.0f;
+                            std::uint32_t indices[3];
+                            for (int v = 0; v < 3; ++v)
+                                indices[v] = edge(tri[t][v][0], tri[t][v][1]);
+                            if (flip)
+                                std::swap(indices[1], indices[2]);
+                            out.insert(out.end(), indices, indices + 3);
+                        }
+                    }
+                }
+        }
+    });
+
+    size_t total = 0;
+    for (const auto& indices : slab_indices)
+        total += indices.size();
+    mesh.indices.reserve(total);
+    for (const auto& indices : slab_indices)
+        mesh.indices.insert(mesh.indices.end(), indices.begin(), indices.end());
+    return mesh;
+}
+
+// Vertex colors for export: positive phase in the orbital color, negative in its complement
+sf::Vector3f phase_color(const Orbital& orbital, int phase) {
+    sf::Vector3f c = orbital.color;
+    return phase >= 0 ? c : sf::Vector3f(1.0f - c.x, 1.0f - c.y, 1.0f - c.z);
+}
+
+// Wavefront OBJ with per-vertex colors (v x y z r g b)
+bool write_obj(const Mesh& mesh, const Orbital& orbital, const std::string& path) {
+    std::ofstream file(path);
+    if (!file)
+        return false;
+    file << "# " << orbital.name << " isosurface\n";
+    for (size_t i = 0; i < mesh.vertices.size(); ++i) {
+        const auto& v = mesh.vertices[i];
+        sf::Vector3f c = phase_color(orbital, mesh.phase[i]);
+        file << "v " << v.x << ' ' << v.y << ' ' << v.z << ' ' << c.x << ' ' << c.y << ' ' << c.z << '\n';
+    }
+    for (const auto& n : mesh.normals)
+        file << "vn " << n.x << ' ' << n.y << ' ' << n.z << '\n';
+    bool normals = !mesh.normals.empty();
+    for (size_t t = 0; t < mesh.indices.size(); t += 3) {
+        file << 'f';
+        for (int c = 0; c < 3; ++c) {
+            std::uint32_t index = mesh.indices[t + c] + 1;
+            file << ' ' << index;
+            if (normals)
+                file << "//" << index;
+        }
+        file << '\n';
+    }
+    return static_cast<bool>(file);
+}
+
+// ASCII PLY with per-vertex colors
+bool write_ply(const Mesh& mesh, const Orbital& orbital, const std::string& path) {
+    std::ofstream file(path);
+    if (!file)
+        return false;
+    file << "ply\nformat ascii 1.0\ncomment " << orbital.name << " isosurface\n"
+         << "element vertex " << mesh.vertices.size() << '\n'
+         << "property float x\nproperty float y\nproperty float z\n"
+         << (mesh.normals.empty() ? "" : "property float nx\nproperty float ny\nproperty float nz\n")
+         << "property uchar red\nproperty uchar green\nproperty uchar blue\n"
+         << "element face " << mesh.indices.size() / 3 << '\n'
+         << "property list uchar uint vertex_indices\nend_header\n";
+    for (size_t i = 0; i < mesh.vertices.size(); ++i) {
+        const auto& v = mesh.vertices[i];
+        sf::Vector3f c = phase_color(orbital, mesh.phase[i]);
+        file << v.x << ' ' << v.y << ' ' << v.z << ' ';
+        if (!mesh.normals.empty())
+            file << mesh.normals[i].x << ' ' << mesh.normals[i].y << ' ' << mesh.normals[i].z << ' ';
+        file << static_cast<int>(c.x * 255.0f) << ' '
+             << static_cast<int>(c.y * 255.0f) << ' ' << static_cast<int>(c.z * 255.0f) << '\n';
+    }
+    for (size_t t = 0; t < mesh.indices.size(); t += 3)
+        file << "3 " << mesh.indices[t] << ' ' << mesh.indices[t + 1] << ' ' << mesh.indices[t + 2] << '\n';
+    return static_cast<bool>(file);
+}
+
+// =======================
+// Isovalue Selection
+// =======================
+
+// Returns the value of rank k in descending order. A parallel log-spaced
+// histogram finds the bucket holding rank k; only that bucket is partially sorted.
+float parallel_select(const std::vector<float>& values, size_t k) {
+    constexpr int BUCKETS = 4096;
+    constexpr size_t BLOCKS = 64;
+    size_t block_size = (values.size() + BLOCKS - 1) / BLOCKS;
+
+    std::vector<float> block_min(BLOCKS, INFINITY), block_max(BLOCKS, -INFINITY);
+    parallel_for(BLOCKS, 1, [&](size_t begin, size_t end) {
+        for (size_t b = begin; b < end; ++b)
+            for (size_t i = b * block_size; i < std::min(values.size(), (b + 1) * block_size); ++i)
+                if (values[i] > 0.0f) {
+                    block_min[b] = std::fmin(block_min[b], std::log(values[i]));
+                    block_max[b] = std::fmax(block_max[b], std::log(values[i]));
+                }
+    });
+    float lo = *std::min_element(block_min.begin(), block_min.end());
+    float hi = *std::max_element(block_max.begin(), block_max.end());
+    if (!(hi > lo))
+        return hi > -INFINITY ? std::exp(hi) : 0.0f;
+
+    // Buckets 1..BUCKETS-1 are log-spaced from the largest value down, BUCKETS holds zeros
+    float width = (hi - lo) / (BUCKETS - 1) * 1.0001f;
+    auto bucket_of = [&](float v) {
+        return v > 0.0f ? 1 + std::min(BUCKETS - 2, static_cast<int>((hi - std::log(v)) / width)) : BUCKETS;
+    };
+    std::vector<std::vector<size_t>> histograms(BLOCKS, std::vector<size_t>(BUCKETS + 1, 0));
+    parallel_for(BLOCKS, 1, [&](size_t begin, size_t end) {
+        for (size_t b = begin; b < end; ++b)
+            for (size_t i = b * block_size; i < std::min(values.size(), (b + 1) * block_size); ++i)
+                ++histograms[b][bucket_of(values[i])];
+    });
+
+    int target = BUCKETS;
+    size_t above = 0;
+    for (int bucket = 1; bucket <= BUCKETS; ++bucket) {
+        size_t count = 0;
+        for (const auto& h : histograms)
+            count += h[bucket];
+        if (above + count > k) {
+            target = bucket;
+            break;
+        }
+        above += count;
+    }
+
+    std::vector<float> candidates;
+    for (float v : values)
+        if (bucket_of(v) == target)
+            candidates.push_back(v);
+    if (candidates.empty())
+        return 0.0f;
+    size_t rank = std::min(k - above, candidates.size() - 1);
+    std::nth_element(candidates.begin(), candidates.begin() + rank, candidates.end(), std::greater<float>());
+    return candidates[rank];
+}
+
+// Value t whose superlevel set {v > t} holds the given fraction of a spherical
+// volume's mass, each grid point weighted by r^2 sin(theta). A histogram of
+// mass over the values' bit patterns (monotone for positive floats, and close
+// to log-spaced) finds the bucket holding t; only that bucket and its occupied
+// neighbours are sorted.
+float spherical_isovalue(const SphericalVolume& volume, float fraction) {
+    constexpr int BUCKETS = 4096;
+    constexpr size_t BLOCKS = 64;
+    size_t directions = static_cast<size_t>(volume.ntheta) * volume.nphi;
+    size_t shells_per_block = (volume.nr + BLOCKS - 1) / BLOCKS;
+    std::vector<float> shell_weight(volume.nr), direction_weight(directions);
+    for (int i = 0; i < volume.nr; ++i) {
+        float r = volume.r_max * i / (volume.nr - 1);
+        shell_weight[i] = r * r;
+    }
+    for (size_t d = 0; d < directions; ++d)
+        direction_weight[d] = std::sin(PI * static_cast<int>(d / volume.nphi) / (volume.ntheta - 1));
+    auto bits_of = [](float v) {
+        std::int32_t bits;
+        std::memcpy(&bits, &v, sizeof(bits));
+        return bits;
+    };
+    auto for_each_point = [&](size_t block, auto&& fn) {
+        size_t last = std::min(static_cast<size_t>(volume.nr), (block + 1) * shells_per_block);
+        for (size_t i = block * shells_per_block; i < last; ++i) {
+            const float* shell = volume.values.data() + i * directions;
+            for (size_t d = 0; d < directions; ++d)
+                if (shell[d] > 0.0f)
+                    fn(shell[d], static_cast<double>(shell[d] * shell_weight[i] * direction_weight[d]));
+        }
+    };
+
+    std::vector<float> block_min(BLOCKS, INFINITY), block_max(BLOCKS, 0.0f);
+    parallel_for(BLOCKS, 1, [&](size_t begin, size_t end) {
+        for (size_t b = begin; b < end; ++b)
+            for_each_point(b, [&](float v, double) {
+                block_min[b] = std::fmin(block_min[b], v);
+                block_max[b] = std::fmax(block_max[b], v);
+            });
+    });
+    float lo = *std::min_element(block_min.begin(), block_min.end());
+    float hi = *std::max_element(block_max.begin(), block_max.end());
+    if (!(hi > lo))
+        return hi;
+
+    // Buckets count down from the largest value
+    std::int32_t hi_bits = bits_of(hi), width = (hi_bits - bits_of(lo)) / BUCKETS + 1;
+    auto bucket_of = [&](float v) { return static_cast<int>((hi_bits - bits_of(v)) / width); };
+    std::vector<std::vector<double>> histograms(BLOCKS, std::vector<double>(BUCKETS, 0.0));
+    parallel_for(BLOCKS, 1, [&](size_t begin, size_t end) {
+        for (size_t b = begin; b < end; ++b)
+            for_each_point(b, [&](float v, double mass) { histograms[b][bucket_of(v)] += mass; });
+    });
+
+    std::vector<double> bucket_mass(BUCKETS, 0.0);
+    double total = 0.0;
+    for (const auto& h : histograms)
+        for (int bucket = 0; bucket < BUCKETS; ++bucket)
+            bucket_mass[bucket] += h[bucket];
+    for (double mass : bucket_mass)
+        total += mass;
+    double wanted = std::fmin(std::fmax(fraction, 0.0f), 1.0f) * total, above = 0.0;
+    int target = BUCKETS - 1;
+    for (int bucket = 0; bucket < BUCKETS; ++bucket) {
+        if (above + bucket_mass[bucket] >= wanted) {
+            target = bucket;
+            break;
+        }
+        above += bucket_mass[bucket];
+    }
+
+    // Each point's value sits at the middle of its mass, and t is interpolated
+    // between the two points around the wanted mass, which may lie in the
+    // nearest occupied bucket on either side
+    int first = target, last = target;
+    while (first > 0 && (first == target || bucket_mass[first] == 0.0))
+        --first;
+    while (last < BUCKETS - 1 && (last == target || bucket_mass[last] == 0.0))
+        ++last;
+    if (first < target)
+        above -= bucket_mass[first];
+    std::vector<std::pair<float, double>> candidates;
+    for (size_t b = 0; b < BLOCKS; ++b)
+        for_each_point(b, [&](float v, double mass) {
+            int bucket = bucket_of(v);
+            if (bucket >= first && bucket <= last)
+                candidates.emplace_back(v, mass);
+        });
+    std::sort(candidates.begin(), candidates.end(), std::greater<std::pair<float, double>>());
+    size_t merged = 0; // Equal values (a shell of an s orbital, mirrored directions) act as one point
+    for (size_t i = 0; i < candidates.size(); ++i) {
+        if (merged > 0 && candidates[merged - 1].first == candidates[i].first)
+            candidates[merged - 1].second += candidates[i].second;
+        else
+            candidates[merged++] = candidates[i];
+    }
+    candidates.resize(merged);
+
+    float previous = first < target ? candidates.front().first : hi;
+    double previous_center = above;
+    for (const auto& candidate : candidates) {
+        double center = above + 0.5 * candidate.second;
+        if (center >= wanted) {
+            float t = static_cast<float>((wanted - previous_center) / std::fmax(center - previous_center, 1e-300));
+            return previous + t * (candidate.first - previous);
+        }
+        above += candidate.second;
+        previous = candidate.first;
+        previous_center = center;
+    }
+    return previous;
+}
+
+// Spherical grid for orbital_isovalue: 64 shells per unit of n, 24 polar rows
+// per unit of l and 24 columns per unit of |m| (one when m = 0, where |psi|^2
+// does not depend on phi). Past the cap it falls back to sampling.
+constexpr size_t ISOVALUE_VOLUME_CELLS = size_t(1) << 23;
+
+// Density value whose superlevel set {|psi|^2 > t} holds the given probability.
+// When a spherical grid resolving the orbital fits in ISOVALUE_VOLUME_CELLS,
+// t comes from quadrature over the tensor-product volume. Otherwise it uses
+// that P(|psi(X)|^2 > t) for X ~ |psi|^2 is exactly that mass, so t is a
+// quantile of the density evaluated at exact samples. Cached per orbital and
+// fraction.
+float orbital_isovalue(const Orbital& orbital, float fraction, float time) {
+    static std::mutex mutex;
+    static std::map<std::tuple<int, int, int, int, float, float>, float> cache;
+    float vibration = vibration_scale(time);
+    auto key = std::make_tuple(orbital.n, orbital.l, orbital.m, orbital.species.charge, orbital.species.reduced_mass, fraction);
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        auto it = cache.find(key);
+        if (it != cache.end())
+            return it->second * vibration;
+    }
+
+    int nr = 256 + 64 * orbital.n, ntheta = 32 + 24 * orbital.l;
+    int nphi = orbital.m == 0 ? 1 : 24 * (std::abs(orbital.m) + 1);
+    float isovalue;
+    if (static_cast<size_t>(nr) * ntheta * nphi <= ISOVALUE_VOLUME_CELLS) {
+        SphericalVolume volume = build_spherical_volume(orbital, nr, ntheta, nphi, sampling_radius(orbital), 0.0f);
+        isovalue = spherical_isovalue(volume, fraction);
+    } else {
+        constexpr size_t BLOCK = 4096;
+        std::vector<float> densities(ISOVALUE_SAMPLES);
+        parallel_for(ISOVALUE_SAMPLES / BLOCK, 1, [&](size_t begin, size_t end) {
+            PointBatch batch;
+            for (size_t block = begin; block < end; ++block) {
+                std::mt19937 gen(static_cast<unsigned>(block * 7919 + 17));
+                std::vector<sf::Vector3f> points = generate_orbital_points(orbital, BLOCK, gen);
+                batch.assign(points.data(), BLOCK);
+                probability_density_batch(orbital, batch.x.data(), batch.y.data(), batch.z.data(), BLOCK, 0.0f,
+                                          &densities[block * BLOCK]);
+            }
+        });
+        float fraction_clamped = std::fmin(std::fmax(fraction, 0.0f), 1.0f);
+        size_t rank = std::min<size_t>(ISOVALUE_SAMPLES - 1, static_cast<size_t>(fraction_clamped * ISOVALUE_SAMPLES));
+        isovalue = parallel_select(densities, rank);
+    }
+
+    std::lock_guard<std::mutex> lock(mutex);
+    cache[key] = isovalue;
+    return isovalue * vibration;
+}
+
+// Outward normals from the analytic -grad |psi|^2 at each vertex (the density
+// falls off across the surface), instead of the grid's finite differences
+void compute_mesh_normals(Mesh& mesh, const Orbital& orbital, float time) {
+    size_t count = mesh.vertices.size();
+    mesh.normals.resize(count);
+    parallel_for(count, 1024, [&](size_t begin, size_t end) {
+        size_t size = end - begin;
+        PointBatch batch(&mesh.vertices[begin], size);
+        std::vector<float> density(size), gx(size), gy(size), gz(size);
+        probability_density_gradient_batch(orbital, batch.x.data(), batch.y.data(), batch.z.data(), size, time, density.data(), gx.data(),
+                                           gy.data(), gz.data());
+        for (size_t i = 0; i < size; ++i) {
+            float length = std::sqrt(gx[i] * gx[i] + gy[i] * gy[i] + gz[i] * gz[i]);
+            float inv = length > 0.0f ? -1.0f / length : 0.0f;
+            mesh.normals[begin + i] = sf::Vector3f(gx[i] * inv, gy[i] * inv, gz[i] * inv);
+        }
+    });
+}
+
+Mesh build_orbital_mesh(const Orbital& orbital, float time) {
+    DensityGrid grid = voxelize_orbital(orbital, MESH_RESOLUTION, sampling_radius(orbital), time);
+    Mesh mesh = extract_isosurface(grid, orbital_isovalue(orbital, MESH_ENCLOSED_FRACTION, time), orbital);
+    compute_mesh_normals(mesh, orbital, time);
+    return mesh;
+}
+
+// =======================
+// Volume Raymarcher
+// =======================
+
+// Evaluates density at count points given as x, y, z arrays (orbital units)
+using DensityBatchFn = std::function<void(const float*, const float*, const float*, size_t, float*)>;
+
+struct DensitySource {
+    DensityBatchFn evaluate;
+    float radius = 0.0f;    // Density is negligible beyond this distance from the nucleus
+    float reference = 1.0f; // Density near the peak, sets the opacity scale
+};
+
+// Analytic density with R_nl^2 tabulated over the bounding sphere, so each
+// sample costs a table lookup plus the trig-free angular polynomial, evaluated
+// across the batch by OrbitalKernel::angular_batch
+DensitySource analytic_source(const Orbital& orbital, float time) {
+    constexpr int TABLE_SIZE = 8192;
+    DensitySource source;
+    source.radius = sampling_radius(orbital);
+
+    auto table = std::make_shared<std::vector<float>>(TABLE_SIZE + 2);
+    float vibration = vibration_scale(time);
+    float step = source.radius / TABLE_SIZE;
+    float a0 = orbital.species.bohr_radius();
+    for (int i = 0; i <= TABLE_SIZE + 1; ++i) {
+        float R = radial_function(orbital.n, orbital.l, i * step, a0);
+        (*table)[i] = R * R * vibration;
+    }
+    OrbitalKernel kernel(orbital);
+    source.evaluate = [kernel, table, step](const float* x, const float* y, const float* z, size_t count, float* out) {
+        const float* R2 = table->data();
+        float r[KERNEL_LANES], radial[KERNEL_LANES];
+        for (size_t begin = 0; begin < count; begin += KERNEL_LANES) {
+            size_t lanes = std::min(KERNEL_LANES, count - begin);
+            const float *bx = x + begin, *by = y + begin, *bz = z + begin;
+            float* Y = out + begin;
+            for (size_t i = 0; i < lanes; ++i)
+                r[i] = std::sqrt(bx[i] * bx[i] + by[i] * by[i] + bz[i] * bz[i]);
+            // Table coordinates are clamped before the int conversion, in their own
+            // loop: fused with the lookup, the float min turns into a branch
+            for (size_t i = 0; i < lanes; ++i)
+                radial[i] = std::min(r[i] / step, static_cast<float>(TABLE_SIZE));
+            for (size_t i = 0; i < lanes; ++i) {
+                float f = radial[i];
+                int k = static_cast<int>(f);
+                float frac = f - k;
+                radial[i] = R2[k] + frac * (R2[k + 1] - R2[k]);
+            }
+            kernel.angular_batch(bx, by, bz, r, lanes, Y);
+            for (size_t i = 0; i < lanes; ++i)
+                Y[i] = radial[i] * Y[i] * Y[i];
+        }
+    };
+    source.reference = orbital_isovalue(orbital, 0.05f, time);
+    return source;
+}
+
+// The grid must outlive the source
+DensitySource grid_source(const DensityGrid& grid, float reference) {
+    DensitySource source;
+    source.evaluate = [&grid](const float* x, const float* y, const float* z, size_t count, float* out) {
+        for (size_t i = 0; i < count; ++i)
+            out[i] = grid.sample(x[i], y[i], z[i]);
+    };
+    float radius = 0.0f;
+    for (int corner = 0; corner < 8; ++corner) {
+        sf::Vector3f p = grid.position(corner & 1 ? grid.nx - 1 : 0, corner & 2 ? grid.ny - 1 : 0, corner & 4 ? grid.nz - 1 : 0);
+        radius = std::fmax(radius, std::sqrt(p.x * p.x + p.y * p.y + p.z * p.z));
+    }
+    source.radius = radius;
+    source.reference = reference;
+    return source;
+}
+
+// Same orbit as the gluLookAt camera in main; world units are orbital units times scale
+struct OrbitCamera {
+    float distance = 10.0f;
+    float angle = 0.0f;
+    float fov_y = 45.0f; // Degrees
+    float scale = 1.0f;
+};
+
+struct Image {
+    int width = 0, height = 0;
+    std::vector<float> rgb;
+};
+
+// e^-x for 0 <= x < 1e9, from e^-x = 2^-k e^f with |f| <= ln 2 / 2 and a
+// degree-6 Taylor polynomial for e^f (relative error below 3e-7; results past
+// x = 87 flush to 0). Unlike std::exp it makes no libm call and the exponent is
+// bounded with an integer max rather than a float clamp, which GCC would turn
+// into a branch, so loops over it vectorize.
+inline float exp_negative(float x) {
+    int k = static_cast<int>(x * 1.44269504f + 0.5f);
+    float f = k * 0.693359375f - x - k * 2.12194440e-4f; // k ln 2 - x, ln 2 split in two
+    float p = 1.0f + f * (1.0f + f * (0.5f + f * (1.0f / 6.0f + f * (1.0f / 24.0f + f * (1.0f / 120.0f + f * (1.0f / 720.0f))))));
+    std::int32_t bits = std::max(127 - k, 0) << 23;
+    float scale;
+    std::memcpy(&scale, &bits, sizeof(scale));
+    return p * scale;
+}
+
+// Emission-absorption raymarching in 16x16 tiles across the thread pool. The rays
+// of a tile advance together as a packet of SoA lanes: each step fills the
+// sample positions, makes one batched density call and composites, all three
+// as branch-free loops over contiguous lanes that the compiler vectorizes.
+// Finished rays are then compacted out, so the lanes stay dense. Rays start
+// and stop at the bounding sphere and end once nearly opaque.
+Image render_volume(const DensitySource& source, const OrbitCamera& camera, sf::Vector3f color, int width, int height) {
+    constexpr int TILE = 16;
+    constexpr float MIN_TRANSMITTANCE = 0.01f;
+
+    Image image;
+    image.width = width;
+    image.height = height;
+    image.rgb.assign(static_cast<size_t>(width) * height * 3, 0.0f);
+
+    // Camera basis in orbital units
+    float eye[3] = {camera.distance * std::sin(camera.angle) / camera.scale, 0.0f,
+                    camera.distance * std::cos(camera.angle) / camera.scale};
+    float eye_len = std::sqrt(eye[0] * eye[0] + eye[2] * eye[2]);
+    float forward[3] = {-eye[0] / eye_len, 0.0f, -eye[2] / eye_len};
+    float right[3] = {-forward[2], 0.0f, forward[0]}; // forward x up
+    float up[3] = {0.0f, 1.0f, 0.0f};
+    float tan_half = std::tan(camera.fov_y * PI / 360.0f);
+    float aspect = static_cast<float>(width) / height;
+
+    float radius = source.radius;
+    float dt = 2.0f * radius / RAYMARCH_STEPS;
+    float optical_step = VOLUME_OPACITY / (source.reference * radius) * dt; // Optical depth per unit density
+
+    int tiles_x = (width + TILE - 1) / TILE, tiles_y = (height + TILE - 1) / TILE;
+    parallel_for(static_cast<size_t>(tiles_x) * tiles_y, 1, [&](size_t begin, size_t end) {
+        constexpr int PACKET = TILE * TILE;
+        // Lane state, compacted after every step; pixel maps a lane to its ray in the tile
+        float dx[PACKET], dy[PACKET], dz[PACKET], t[PACKET], t_far[PACKET], transmittance[PACKET], accumulated[PACKET];
+        float px[PACKET], py[PACKET], pz[PACKET], density[PACKET], result[PACKET];
+        int pixel[PACKET];
+
+        for (size_t tile = begin; tile < end; ++tile) {
+            int x0 = static_cast<int>(tile % tiles_x) * TILE, y0 = static_cast<int>(tile / tiles_x) * TILE;
+            int tile_w = std::min(TILE, width - x0), tile_h = std::min(TILE, height - y0);
+            int packet = tile_w * tile_h;
+            int live = 0;
+            for (int i = 0; i < packet; ++i) {
+                result[i] = 0.0f;
+                float u = (2.0f * (x0 + i % tile_w + 0.5f) / width - 1.0f) * tan_half * aspect;
+                float v = (1.0f - 2.0f * (y0 + i / tile_w + 0.5f) / height) * tan_half;
+                float d[3];
+                for (int a = 0; a < 3; ++a)
+                    d[a] = forward[a] + u * right[a] + v * up[a];
+                float len = std::sqrt(d[0] * d[0] + d[1] * d[1] + d[2] * d[2]);
+                for (int a = 0; a < 3; ++a)
+                    d[a] /= len;
+
+                // Empty-space skipping: clip the ray to the bounding sphere
+                float b = eye[0] * d[0] + eye[1] * d[1] + eye[2] * d[2];
+                float c = eye_len * eye_len - radius * radius;
+                float disc = b * b - c;
+                if (disc <= 0.0f)
+                    continue;
+                dx[live] = d[0], dy[live] = d[1], dz[live] = d[2];
+                t[live] = std::fmax(0.0f, -b - std::sqrt(disc));
+                t_far[live] = -b + std::sqrt(disc);
+                transmittance[live] = 1.0f;
+                accumulated[live] = 0.0f;
+                pixel[live++] = i;
+            }
+
+            while (live > 0) {
+                for (int a = 0; a < live; ++a) {
+                    float s = t[a] + 0.5f * dt;
+                    px[a] = eye[0] + s * dx[a];
+                    py[a] = eye[1] + s * dy[a];
+                    pz[a] = eye[2] + s * dz[a];
+                }
+                source.evaluate(px, py, pz, live, density);
+                for (int a = 0; a < live; ++a) {
+                    float keep = exp_negative(density[a] * optical_step); // 1 - alpha
+                    accumulated[a] += transmittance[a] * (1.0f - keep);
+                    transmittance[a] *= keep;
+                    t[a] += dt;
+                }
+
+                int still = 0;
+                for (int a = 0; a < live; ++a) {
+                    if (t[a] < t_far[a] && transmittance[a] > MIN_TRANSMITTANCE) {
+                        dx[still] = dx[a], dy[still] = dy[a], dz[still] = dz[a];
+                        t[still] = t[a], t_far[still] = t_far[a];
+                        transmittance[still] = transmittance[a], accumulated[still] = accumulated[a];
+                        pixel[still++] = pixel[a];
+                    } else {
+                        result[pixel[a]] = accumulated[a];
+                    }
+                }
+                live = still;
+            }
+
+            for (int i = 0; i < packet; ++i) {
+                float* out = &image.rgb[(static_cast<size_t>(y0 + i / tile_w) * width + x0 + i % tile_w) * 3];
+                out[0] = result[i] * color.x;
+                out[1] = result[i] * color.y;
+                out[2] = result[i] * color.z;
+            }
+        }
+    });
+    return image;
+}
+
+// =======================
+// Cross-Section Slices
+// =======================
+
+// Plane through the nucleus spanned by unit vectors u (image right) and v (image up)
+struct SlicePlane {
+    sf::Vector3f u, v;
+    float half_height; // Orbital units covered from the center to the top edge
+};
+
+// The plane facing the orbit camera, framed like the perspective view at the nucleus
+SlicePlane camera_slice(const OrbitCamera& camera) {
+    SlicePlane plane;
+    plane.u = sf::Vector3f(std::cos(camera.angle), 0.0f, -std::sin(camera.angle));
+    plane.v = sf::Vector3f(0.0f, 1.0f, 0.0f);
+    plane.half_height = camera.distance * std::tan(camera.fov_y * PI / 360.0f) / camera.scale;
+    return plane;
+}
+
+// Heatmap of a density, or of a signed psi (positive in the orbital color,
+// negative in its complement, nodes dark). Values are computed per 32x32 tile
+// with one batched call each, normalized by the image maximum, then colored.
+Image render_slice(const DensityBatchFn& evaluate, const SlicePlane& plane, int width, int height, bool signed_values, const Orbital& orbital) {
+    constexpr int TILE = 32;
+    Image image;
+    image.width = width;
+    image.height = height;
+    image.rgb.resize(static_cast<size_t>(width) * height * 3);
+
+    std::vector<float> values(static_cast<size_t>(width) * height);
+    float pixel = 2.0f * plane.half_height / height;
+    int tiles_x = (width + TILE - 1) / TILE, tiles_y = (height + TILE - 1) / TILE;
+    size_t tiles = static_cast<size_t>(tiles_x) * tiles_y;
+    std::vector<float> tile_max(tiles, 0.0f);
+
+    parallel_for(tiles, 1, [&](size_t begin, size_t end) {
+        float x[TILE * TILE], y[TILE * TILE], z[TILE * TILE], result[TILE * TILE];
+        for (size_t tile = begin; tile < end; ++tile) {
+            int x0 = static_cast<int>(tile % tiles_x) * TILE, y0 = static_cast<int>(tile / tiles_x) * TILE;
+            int tile_w = std::min(TILE, width - x0), tile_h = std::min(TILE, height - y0);
+            int count = tile_w * tile_h;
+            for (int i = 0; i < count; ++i) {
+                float a = (x0 + i % tile_w + 0.5f - 0.5f * width) * pixel;
+                float b = (0.5f * height - y0 - i / tile_w - 0.5f) * pixel;
+                x[i] = a * plane.u.x + b * plane.v.x;
+                y[i] = a * plane.u.y + b * plane.v.y;
+                z[i] = a * plane.u.z + b * plane.v.z;
+            }
+            evaluate(x, y, z, count, result);
+            for (int i = 0; i < count; ++i) {
+                float value = result[i];
+                values[static_cast<size_t>(y0 + i / tile_w) * width + x0 + i % tile_w] = value;
+                tile_max[tile] = std::fmax(tile_max[tile], std::fabs(value));
+            }
+        }
+    });
+
+    float max_value = std::fmax(*std::max_element(tile_max.begin(), tile_max.end()), 1e-30f);
+    sf::Vector3f positive = phase_color(orbital, 1), negative = phase_color(orbital, -1);
+    parallel_for(values.size(), 1 << 14, [&](size_t begin, size_t end) {
+        for (size_t i = begin; i < end; ++i) {
+            // Square root keeps the exponential tails and radial nodes visible
+            float t = std::sqrt(std::fabs(values[i]) / max_value);
+            sf::Vector3f c = values[i] >= 0.0f ? positive : negative;
+            float white = signed_values ? 0.0f : std::fmax(0.0f, (t - 0.7f) / 0.3f);
+            float level = signed_values ? t : std::fmin(t / 0.7f, 1.0f);
+            image.rgb[3 * i] = c.x * level * (1.0f - white) + white;
+            image.rgb[3 * i + 1] = c.y * level * (1.0f - white) + white;
+            image.rgb[3 * i + 2] = c.z * level * (1.0f - white) + white;
+        }
+    });
+    return image;
+}
+
+Image render_slice(const Orbital& orbital, const SlicePlane& plane, int width, int height, bool signed_psi, float time) {
+    DensityBatchFn evaluate = [&](const float* x, const float* y, const float* z, size_t count, float* out) {
+        if (signed_psi)
+            wavefunction_batch(orbital, x, y, z, count, out);
+        else
+            probability_density_batch(orbital, x, y, z, count, time, out);
+    };
+    return render_slice(evaluate, plane, width, height, signed_psi, orbital);
+}
+
+// Draws an image over the whole viewport (top row first)
+void draw_image(const Image& image) {
+    std::vector<unsigned char> bytes(image.rgb.size());
+    for (int y = 0; y < image.height; ++y) {
+        const float* src = &image.rgb[static_cast<size_t>(image.height - 1 - y) * image.width * 3];
+        unsigned char* dst = &bytes[static_cast<size_t>(y) * image.width * 3];
+        for (int i = 0; i < image.width * 3; ++i)
+            dst[i] = static_cast<unsigned char>(std::fmin(std::fmax(src[i], 0.0f), 1.0f) * 255.0f + 0.5f);
+    }
+    glMatrixMode(GL_PROJECTION);
+    glLoadIdentity();
+    glMatrixMode(GL_MODELVIEW);
+    glLoadIdentity();
+    glDisable(GL_DEPTH_TEST);
+    glRasterPos2f(-1.0f, -1.0f);
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+    glDrawPixels(image.width, image.height, GL_RGB, GL_UNSIGNED_BYTE, bytes.data());
+    glEnable(GL_DEPTH_TEST);
+}
+
+// Binary PPM (P6)
+bool write_ppm(const Image& image, const std::string& path) {
+    std::ofstream file(path, std::ios::binary);
+    if (!file)
+        return false;
+    file << "P6\n" << image.width << ' ' << image.height << "\n255\n";
+    std::vector<unsigned char> bytes(image.rgb.size());
+    for (size_t i = 0; i < bytes.size(); ++i)
+        bytes[i] = static_cast<unsigned char>(std::fmin(std::fmax(image.rgb[i], 0.0f), 1.0f) * 255.0f + 0.5f);
+    file.write(reinterpret_cast<const char*>(bytes.data()), bytes.size());
+    return static_cast<bool>(file);
+}
+
+// =======================
+// Sparse Brick Map
+// =======================
+
+// Lazily built, multi-resolution density over a centered cube. The cube is
+// split into bricks of BRICK_SIZE^3 cells. A brick is only built when first
+// sampled: a 3^3 probe decides whether it needs full resolution (density above
+// the threshold, or a large variation across the brick). Otherwise just its 8
+// corners are kept, which doubles as the coarse mip level. Memory follows the
+// occupied volume instead of the bounding box.
+constexpr int BRICK_SIZE = 8;
+constexpr int BRICK_SAMPLES = BRICK_SIZE + 1; // Per axis, brick faces are duplicated
+
+class BrickMap {
+public:
+    BrickMap(DensityBatchFn evaluate, float half_extent, int bricks_per_axis, float threshold, float variation_threshold)
+        : evaluate_(std::move(evaluate)), half_extent_(half_extent), bricks_(bricks_per_axis),
+          threshold_(threshold), variation_threshold_(variation_threshold),
+          cell_(2.0f * half_extent / (bricks_per_axis * BRICK_SIZE)),
+          states_(static_cast<size_t>(bricks_per_axis) * bricks_per_axis * bricks_per_axis),
+          coarse_(states_.size()), fine_(states_.size()) {}
+
+    // Trilinear density; builds the containing brick on first use (thread-safe)
+    float sample(float x, float y, float z) {
+        float f[3] = {(x + half_extent_) / cell_, (y + half_extent_) / cell_, (z + half_extent_) / cell_};
+        int b[3];
+        float local[3];
+        for (int a = 0; a < 3; ++a) {
+            if (f[a] < 0.0f || f[a] >= bricks_ * BRICK_SIZE)
+                return 0.0f;
+            b[a] = std::min(static_cast<int>(f[a]) / BRICK_SIZE, bricks_ - 1);
+            local[a] = f[a] - b[a] * BRICK_SIZE;
+        }
+        size_t brick = brick_index(b[0], b[1], b[2]);
+        ensure_built(brick, b);
+
+        if (!fine_[brick]) {
+            const auto& c = coarse_[brick];
+            float tx = local[0] / BRICK_SIZE, ty = local[1] / BRICK_SIZE, tz = local[2] / BRICK_SIZE;
+            return trilinear(c[0], c[1], c[2], c[3], c[4], c[5], c[6], c[7], tx, ty, tz);
+        }
+
+        const float* v = fine_[brick].get();
+        int i = std::min(static_cast<int>(local[0]), BRICK_SIZE - 1);
+        int j = std::min(static_cast<int>(local[1]), BRICK_SIZE - 1);
+        int k = std::min(static_cast<int>(local[2]), BRICK_SIZE - 1);
+        const float* p = v + (k * BRICK_SAMPLES + j) * BRICK_SAMPLES + i;
+        constexpr int SY = BRICK_SAMPLES, SZ = BRICK_SAMPLES * BRICK_SAMPLES;
+        return trilinear(p[0], p[1], p[SY], p[SY + 1], p[SZ], p[SZ + 1], p[SZ + SY], p[SZ + SY + 1],
+                         local[0] - i, local[1] - j, local[2] - k);
+    }
+
+private:
+    enum : std::uint8_t { UNBUILT, BUILDING, READY };
+
+    static float trilinear(float c000, float c100, float c010, float c110, float c001, float c101, float c011, float c111,
+                           float tx, float ty, float tz) {
+        float c00 = c000 + tx * (c100 - c000), c10 = c010 + tx * (c110 - c010);
+        float c01 = c001 + tx * (c101 - c001), c11 = c011 + tx * (c111 - c011);
+        float c0 = c00 + ty * (c10 - c00), c1 = c01 + ty * (c11 - c01);
+        return c0 + tz * (c1 - c0);
+    }
+
+    size_t brick_index(int i, int j, int k) const {
+        return (static_cast<size_t>(k) * bricks_ + j) * bricks_ + i;
+    }
+
+    void ensure_built(size_t brick, const int* b) {
+        std::uint8_t state = states_[brick].load(std::memory_order_acquire);
+        if (state == READY)
+            return;
+        if (state == UNBUILT && states_[brick].compare_exchange_strong(state, BUILDING)) {
+            build(brick, b);
+            states_[brick].store(READY, std::memory_order_release);
+            return;
+        }
+        while (states_[brick].load(std::memory_order_acquire) != READY)
+            std::this_thread::yield(); // Another thread is building it
+    }
+
+    // Evaluates an n^3 lattice spanning the brick (corners included)
+    std::vector<float> evaluate_lattice(const int* b, int n) {
+        size_t count = static_cast<size_t>(n) * n * n;
+        PointBatch lattice(count);
+        std::vector<float> out(count);
+        float step = cell_ * BRICK_SIZE / (n - 1);
+        float origin[3];
+        for (int a = 0; a < 3; ++a)
+            origin[a] = -half_extent_ + b[a] * BRICK_SIZE * cell_;
+        for (size_t idx = 0; idx < count; ++idx) {
+            lattice.x[idx] = origin[0] + (idx % n) * step;
+            lattice.y[idx] = origin[1] + (idx / n % n) * step;
+            lattice.z[idx] = origin[2] + (idx / n / n) * step;
+        }
+        evaluate_(lattice.x.data(), lattice.y.data(), lattice.z.data(), count, out.data());
+        return out;
+    }
+
+    void build(size_t brick, const int* b) {
+        std::vector<float> probe = evaluate_lattice(b, 3);
+        auto corner = [&](int c) { return probe[((c >> 2) * 2 * 3 + ((c >> 1) & 1) * 2) * 3 + (c & 1) * 2]; };
+        for (int c = 0; c < 8; ++c)
+            coarse_[brick][c] = corner(c);
+        float lo = *std::min_element(probe.begin(), probe.end());
+        float hi = *std::max_element(probe.begin(), probe.end());
+        if (hi < threshold_ && hi - lo < variation_threshold_)
+            return; // Coarse corners are enough
+
+        std::vector<float> values = evaluate_lattice(b, BRICK_SAMPLES);
+        fine_[brick].reset(new float[values.size()]);
+        std::copy(values.begin(), values.end(), fine_[brick].get());
+    }
+
+    DensityBatchFn evaluate_;
+    float half_extent_;
+    int bricks_;
+    float threshold_, variation_threshold_;
+    float cell_;
+    std::vector<std::atomic<std::uint8_t>> states_;
+    std::vector<std::array<float, 8>> coarse_;
+    std::vector<std::unique_ptr<float[]>> fine_;
+};
+
+// Brick map over the orbital's bounding sphere; bricks refine where the density
+// exceeds a small fraction of its 90% isovalue
+std::unique_ptr<BrickMap> make_orbital_brick_map(const Orbital& orbital, int bricks_per_axis, float time) {
+    float half_extent = sampling_radius(orbital);
+    float isovalue = orbital_isovalue(orbital, 0.9f, time);
+    DensityBatchFn evaluate = [orbital, time](const float* x, const float* y, const float* z, size_t count, float* out) {
+        probability_density_batch(orbital, x, y, z, count, time, out);
+    };
+    return std::unique_ptr<BrickMap>(new BrickMap(evaluate, half_extent, bricks_per_axis, 0.01f * isovalue, 0.01f * isovalue));
+}
+
+// =======================
+// Compressed Density Grid
+// =======================
+
+// Block-quantized copy of a DensityGrid. Voxels are grouped into 8^3 blocks;
+// each block stores an offset and a step, and its voxels as 8, 12 or 16-bit
+// codes. Any voxel decodes independently, so trilinear lookups stay random
+// access. Error bounds, with R the block range, b the bit depth and M the
+// largest magnitude the block's decode computes (float rounding of the decode):
+//   Linear: |error| <= R / (2 (2^b - 1)) + 2 eps M, R = max - min of the block.
+//   Log:    relative error <= exp(R / (2 (2^b - 2)) + 2 eps M) - 1 + eps, R the range
+//           of ln(value); code 0 is reserved for values below the floor, which decode to 0.
+// In both modes blocks whose magnitudes all lie below peak * ZERO_FLOOR are
+// stored as zero (absolute error <= peak * ZERO_FLOOR), so empty tail blocks
+// cost no payload at all.
+// Log mode suits the exponential radial tails, where linear blocks spanning a
+// node or a falloff would lose the small values entirely; linear decodes faster.
+constexpr int COMPRESSED_BLOCK = 8;
+constexpr int COMPRESSED_BLOCK_VOXELS = COMPRESSED_BLOCK * COMPRESSED_BLOCK * COMPRESSED_BLOCK;
+constexpr float ZERO_FLOOR = 1e-7f;
+
+enum class Quantization : std::uint8_t { Linear, Log };
+
+struct CompressedGrid {
+    int nx = 0, ny = 0, nz = 0;
+    sf::Vector3f origin, spacing;
+    int bits = 8;
+    Quantization mode = Quantization::Linear;
+    float floor = 0.0f; // Values below decode to zero
+    int bx = 0, by = 0, bz = 0; // Blocks per axis
+
+    struct Block {
+        float offset = 0.0f, step = 0.0f;
+        std::uint32_t payload = 0; // Byte offset, UINT32_MAX for constant blocks
+    };
+    std::vector<Block> blocks;
+    std::vector<std::uint8_t> bytes;
+
+    size_t memory_bytes() const { return blocks.size() * sizeof(Block) + bytes.size(); }
+
+    float at(int i, int j, int k) const {
+        const Block& block = blocks[block_index(i, j, k)];
+        return decode(block, ((k % COMPRESSED_BLOCK) * COMPRESSED_BLOCK + j % COMPRESSED_BLOCK) * COMPRESSED_BLOCK + i % COMPRESSED_BLOCK);
+    }
+
+    // Trilinear interpolation, zero outside the grid. When the 8 corners share
+    // a block (most lookups) the block is resolved once.
+    float sample(float x, float y, float z) const {
+        float fx = (x - origin.x) / spacing.x, fy = (y - origin.y) / spacing.y, fz = (z - origin.z) / spacing.z;
+        if (fx < 0.0f || fy < 0.0f || fz < 0.0f || fx >= nx - 1 || fy >= ny - 1 || fz >= nz - 1)
+            return 0.0f;
+        int i = static_cast<int>(fx), j = static_cast<int>(fy), k = static_cast<int>(fz);
+        float tx = fx - i, ty = fy - j, tz = fz - k;
+        float v[8];
+        int li = i % COMPRESSED_BLOCK, lj = j % COMPRESSED_BLOCK, lk = k % COMPRESSED_BLOCK;
+        if (li < COMPRESSED_BLOCK - 1 && lj < COMPRESSED_BLOCK - 1 && lk < COMPRESSED_BLOCK - 1) {
+            const Block& block = blocks[block_index(i, j, k)];
+            if (block.payload == UINT32_MAX)
+                return block.offset;
+            constexpr int SY = COMPRESSED_BLOCK, SZ = COMPRESSED_BLOCK * COMPRESSED_BLOCK;
+            int local = (lk * COMPRESSED_BLOCK + lj) * COMPRESSED_BLOCK + li;
+            for (int c = 0; c < 8; ++c)
+                v[c] = decode(block, local + (c & 1) + (c & 2 ? SY : 0) + (c & 4 ? SZ : 0));
+        } else {
+            for (int c = 0; c < 8; ++c)
+                v[c] = at(i + (c & 1), j + (c >> 1 & 1), k + (c >> 2));
+        }
+        float c00 = v[0] + tx * (v[1] - v[0]);
+        float c10 = v[2] + tx * (v[3] - v[2]);
+        float c01 = v[4] + tx * (v[5] - v[4]);
+        float c11 = v[6] + tx * (v[7] - v[6]);
+        float c0 = c00 + ty * (c10 - c00);
+        float c1 = c01 + ty * (c11 - c01);
+        return c0 + tz * (c1 - c0);
+    }
+
+    size_t block_index(int i, int j, int k) const {
+        return (static_cast<size_t>(k / COMPRESSED_BLOCK) * by + j / COMPRESSED_BLOCK) * bx + i / COMPRESSED_BLOCK;
+    }
+
+    float decode(const Block& block, int local) const {
+        if (block.payload == UINT32_MAX)
+            return block.offset; // Constant block stores the decoded value
+        const std::uint8_t* p = bytes.data() + block.payload;
+        unsigned code;
+        if (bits == 8) {
+            code = p[local];
+        } else if (bits == 16) {
+            code = p[2 * local] | (p[2 * local + 1] << 8);
+        } else { // Two 12-bit codes per 3 bytes
+            p += local / 2 * 3;
+            code = local % 2 ? (p[1] >> 4) | (p[2] << 4) : p[0] | ((p[1] & 0xF) << 8);
+        }
+        if (mode == Quantization::Linear)
+            return block.offset + code * block.step;
+        return code == 0 ? 0.0f : std::exp(block.offset + (code - 1) * block.step);
+    }
+
+    // Worst-case error over all blocks: absolute for Linear, relative (above the floor) for Log.
+    // Valid for voxels; trilinear samples interpolate errors, so stay within the same bound.
+    float error_bound() const {
+        unsigned levels = (1u << bits) - (mode == Quantization::Linear ? 1 : 2);
+        float bound = 0.0f;
+        for (const Block& block : blocks) {
+            float magnitude = std::fmax(std::fabs(block.offset), std::fabs(block.offset + levels * block.step));
+            bound = std::fmax(bound, 0.5f * block.step + 2.0f * FLT_EPSILON * magnitude);
+        }
+        return mode == Quantization::Linear ? std::fmax(bound, floor) : std::expm1(bound) + FLT_EPSILON;
+    }
+};
+
+CompressedGrid compress_grid(const DensityGrid& grid, int bits, Quantization mode) {
+    CompressedGrid result;
+    result.nx = grid.nx;
+    result.ny = grid.ny;
+    result.nz = grid.nz;
+    result.origin = grid.origin;
+    result.spacing = grid.spacing;
+    result.bits = bits == 12 || bits == 16 ? bits : 8;
+    result.mode = mode;
+    result.bx = (grid.nx + COMPRESSED_BLOCK - 1) / COMPRESSED_BLOCK;
+    result.by = (grid.ny + COMPRESSED_BLOCK - 1) / COMPRESSED_BLOCK;
+    result.bz = (grid.nz + COMPRESSED_BLOCK - 1) / COMPRESSED_BLOCK;
+    size_t block_count = static_cast<size_t>(result.bx) * result.by * result.bz;
+    result.blocks.resize(block_count);
+
+    float peak = 0.0f; // Largest magnitude, so blocks of negative psi are not taken for empty ones
+    for (float value : grid.values)
+        peak = std::fmax(peak, std::fabs(value));
+    result.floor = peak * ZERO_FLOOR;
+    unsigned max_code = (1u << result.bits) - 1;
+    size_t block_bytes = static_cast<size_t>(COMPRESSED_BLOCK_VOXELS) * result.bits / 8;
+
+    // Encode every block in parallel into its own slot, then pack the non-constant ones
+    std::vector<std::vector<std::uint8_t>> encoded(block_count);
+    parallel_for(block_count, 1, [&](size_t begin, size_t end) {
+        std::vector<float> local(COMPRESSED_BLOCK_VOXELS);
+        for (size_t b = begin; b < end; ++b) {
+            int i0 = static_cast<int>(b % result.bx) * COMPRESSED_BLOCK;
+            int j0 = static_cast<int>(b / result.bx % result.by) * COMPRESSED_BLOCK;
+            int k0 = static_cast<int>(b / result.bx / result.by) * COMPRESSED_BLOCK;
+            // Voxels past the grid edge repeat the last one
+            float peak_value = 0.0f;
+            for (int v = 0; v < COMPRESSED_BLOCK_VOXELS; ++v) {
+                int i = std::min(i0 + v % COMPRESSED_BLOCK, grid.nx - 1);
+                int j = std::min(j0 + v / COMPRESSED_BLOCK % COMPRESSED_BLOCK, grid.ny - 1);
+                int k = std::min(k0 + v / (COMPRESSED_BLOCK * COMPRESSED_BLOCK), grid.nz - 1);
+                float value = grid.at(i, j, k);
+                if (mode == Quantization::Log)
+                    value = value < result.floor ? -INFINITY : std::log(value);
+                local[v] = value;
+                peak_value = std::fmax(peak_value, std::fabs(grid.at(i, j, k)));
+            }
+
+            CompressedGrid::Block& block = result.blocks[b];
+            if (peak_value < result.floor) {
+                block.payload = UINT32_MAX; // Empty tail
+                continue;
+            }
+
+            float lo = INFINITY, hi = -INFINITY;
+            bool below_floor = false;
+            for (float value : local) {
+                if (value == -INFINITY) {
+                    below_floor = true;
+                    continue;
+                }
+                lo = std::fmin(lo, value);
+                hi = std::fmax(hi, value);
+            }
+
+            if (lo == INFINITY || (hi == lo && !below_floor)) {
+                // Constant block (all zero in log mode), no payload
+                block.offset = lo == INFINITY ? 0.0f : (mode == Quantization::Log ? std::exp(lo) : lo);
+                block.payload = UINT32_MAX;
+                continue;
+            }
+
+            unsigned levels = mode == Quantization::Linear ? max_code : max_code - 1;
+            block.offset = lo;
+            block.step = hi > lo ? (hi - lo) / levels : 0.0f;
+            std::vector<std::uint8_t>& out = encoded[b];
+            out.assign(block_bytes, 0);
+            for (int v = 0; v < COMPRESSED_BLOCK_VOXELS; ++v) {
+                unsigned code;
+                if (local[v] == -INFINITY)
+                    code = 0;
+                else {
+                    code = block.step > 0.0f ? static_cast<unsigned>(std::lround((local[v] - lo) / block.step)) : 0;
+                    code = std::min(code, levels);
+                    if (mode == Quantization::Log)
+                        ++code;
+                }
+                if (result.bits == 8) {
+                    out[v] = static_cast<std::uint8_t>(code);
+                } else if (result.bits == 16) {
+                    out[2 * v] = static_cast<std::uint8_t>(code);
+                    out[2 * v + 1] = static_cast<std::uint8_t>(code >> 8);
+                } else {
+                    std::uint8_t* p = out.data() + v / 2 * 3;
+                    if (v % 2) {
+                        p[1] |= static_cast<std::uint8_t>((code & 0xF) << 4);
+                        p[2] = static_cast<std::uint8_t>(code >> 4);
+                    } else {
+                        p[0] = static_cast<std::uint8_t>(code);
+                        p[1] |= static_cast<std::uint8_t>(code >> 8);
+                    }
+                }
+            }
+        }
+    });
+
+    for (size_t b = 0; b < block_count; ++b) {
+        if (encoded[b].empty())
+            continue;
+        result.blocks[b].payload = static_cast<std::uint32_t>(result.bytes.size());
+        result.bytes.insert(result.bytes.end(), encoded[b].begin(), encoded[b].end());
+    }
+    return result;
+}
+
+DensitySource compressed_source(const CompressedGrid& grid, float reference) {
+    DensitySource source;
+    source.evaluate = [&grid](const float* x, const float* y, const float* z, size_t count, float* out) {
+        for (size_t i = 0; i < count; ++i)
+            out[i] = grid.sample(x[i], y[i], z[i]);
+    };
+    float radius = 0.0f;
+    for (int corner = 0; corner < 8; ++corner) {
+        float px = grid.origin.x + (corner & 1 ? grid.nx - 1 : 0) * grid.spacing.x;
+        float py = grid.origin.y + (corner & 2 ? grid.ny - 1 : 0) * grid.spacing.y;
+        float pz = grid.origin.z + (corner & 4 ? grid.nz - 1 : 0) * grid.spacing.z;
+        radius = std::fmax(radius, std::sqrt(px * px + py * py + pz * pz));
+    }
+    source.radius = radius;
+    source.reference = reference;
+    return source;
+}
+
+// Decodes every voxel back into a plain grid, within error_bound() of the original
+DensityGrid decompress_grid(const CompressedGrid& grid) {
+    DensityGrid result;
+    result.nx = grid.nx;
+    result.ny = grid.ny;
+    result.nz = grid.nz;
+    result.origin = grid.origin;
+    result.spacing = grid.spacing;
+    result.values.resize(static_cast<size_t>(grid.nx) * grid.ny * grid.nz);
+    parallel_for(grid.nz, 1, [&](size_t begin, size_t end) {
+        for (int k = static_cast<int>(begin); k < static_cast<int>(end); ++k)
+            for (int j = 0; j < grid.ny; ++j)
+                for (int i = 0; i < grid.nx; ++i)
+                    result.values[result.index(i, j, k)] = grid.at(i, j, k);
+    });
+    return result;
+}
+
+// Binary layout: "OCG1", header fields, block table, payload. Little-endian host assumed.
+bool save_compressed_grid(const CompressedGrid& grid, const std::string& path) {
+    std::ofstream file(path, std::ios::binary);
+    if (!file)
+        return false;
+    auto put = [&](const void* data, size_t size) { file.write(static_cast<const char*>(data), size); };
+    std::uint8_t mode = static_cast<std::uint8_t>(grid.mode);
+    std::uint64_t payload_size = grid.bytes.size();
+    put("OCG1", 4);
+    put(&grid.nx, sizeof(int));
+    put(&grid.ny, sizeof(int));
+    put(&grid.nz, sizeof(int));
+    put(&grid.origin, sizeof(sf::Vector3f));
+    put(&grid.spacing, sizeof(sf::Vector3f));
+    put(&grid.bits, sizeof(int));
+    put(&mode, 1);
+    put(&grid.floor, sizeof(float));
+    put(grid.blocks.data(), grid.blocks.size() * sizeof(CompressedGrid::Block));
+    put(&payload_size, sizeof(payload_size));
+    put(grid.bytes.data(), grid.bytes.size());
+    return static_cast<bool>(file);
+}
+
+bool load_compressed_grid(const std::string& path, CompressedGrid& grid) {
+    std::ifstream file(path, std::ios::binary);
+    if (!file)
+        return false;
+    auto get = [&](void* data, size_t size) { return static_cast<bool>(file.read(static_cast<char*>(data), size)); };
+    char magic[4];
+    std::uint8_t mode = 0;
+    std::uint64_t payload_size = 0;
+    CompressedGrid result;
+    if (!get(magic, 4) || std::string(magic, 4) != "OCG1")
+        return false;
+    if (!get(&result.nx, sizeof(int)) || !get(&result.ny, sizeof(int)) || !get(&result.nz, sizeof(int)) ||
+        !get(&result.origin, sizeof(sf::Vector3f)) || !get(&result.spacing, sizeof(sf::Vector3f)) ||
+        !get(&result.bits, sizeof(int)) || !get(&mode, 1) || !get(&result.floor, sizeof(float)))
+        return false;
+    if (result.nx < 2 || result.ny < 2 || result.nz < 2 || (result.bits != 8 && result.bits != 12 && result.bits != 16) || mode > 1)
+        return false;
+    result.mode = static_cast<Quantization>(mode);
+    result.bx = (result.nx + COMPRESSED_BLOCK - 1) / COMPRESSED_BLOCK;
+    result.by = (result.ny + COMPRESSED_BLOCK - 1) / COMPRESSED_BLOCK;
+    result.bz = (result.nz + COMPRESSED_BLOCK - 1) / COMPRESSED_BLOCK;
+    result.blocks.resize(static_cast<size_t>(result.bx) * result.by * result.bz);
+    if (!get(result.blocks.data(), result.blocks.size() * sizeof(CompressedGrid::Block)) || !get(&payload_size, sizeof(payload_size)))
+        return false;
+    size_t block_bytes = static_cast<size_t>(COMPRESSED_BLOCK_VOXELS) * result.bits / 8;
+    for (const CompressedGrid::Block& block : result.blocks)
+        if (block.payload != UINT32_MAX && block.payload + block_bytes > payload_size)
+            return false;
+    result.bytes.resize(payload_size);
+    if (!get(result.bytes.data(), payload_size))
+        return false;
+    grid = std::move(result);
+    return true;
+}
+
+// =======================
+// Gaussian Cube Files
+// =======================
+
+// Coordinates are in bohr, as in the cube format. Values are stored with z
+// varying fastest, six per line, each (x, y) row starting a new line.
+constexpr float ANGSTROM_PER_BOHR = 0.529177f;
+
+// Read-only view of a whole file: memory-mapped where available, read into a
+// buffer otherwise
+class MappedFile {
+public:
+    explicit MappedFile(const std::string& path) {
+#if defined(_WIN32)
+        std::ifstream file(path, std::ios::binary);
+        if (!file)
+            return;
+        buffer_.assign(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+        data_ = buffer_.data();
+        size_ = buffer_.size();
+#else
+        int fd = open(path.c_str(), O_RDONLY);
+        if (fd < 0)
+            return;
+        struct stat info;
+        if (fstat(fd, &info) == 0 && info.st_size > 0) {
+            void* mapped = mmap(nullptr, info.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+            if (mapped != MAP_FAILED) {
+                madvise(mapped, info.st_size, MADV_SEQUENTIAL);
+                data_ = static_cast<const char*>(mapped);
+                size_ = info.st_size;
+            }
+        }
+        close(fd);
+#endif
+    }
+
+    ~MappedFile() {
+#if !defined(_WIN32)
+        if (data_)
+            munmap(const_cast<char*>(data_), size_);
+#endif
+    }
+
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    const char* data() const { return data_; }
+    size_t size() const { return size_; }
+
+private:
+    const char* data_ = nullptr;
+    size_t size_ = 0;
+#if defined(_WIN32)
+    std::vector<char> buffer_;
+#endif
+};
+
+// Writes one atom (the nucleus, charge 1) at the origin. The (x, y) rows are
+// formatted in parallel, then written in order.
+bool write_cube(const DensityGrid& grid, const std::string& comment, const std::string& path) {
+    std::ofstream file(path, std::ios::binary);
+    if (!file)
+        return false;
+    char line[128];
+    file << comment << "\nGenerated by Multiple Orbitals, values on a uniform grid\n";
+    std::snprintf(line, sizeof(line), "%5d %11.6f %11.6f %11.6f\n", 1, grid.origin.x / BOHR_RADIUS,
+                  grid.origin.y / BOHR_RADIUS, grid.origin.z / BOHR_RADIUS);
+    file << line;
+    std::snprintf(line, sizeof(line), "%5d %11.6f %11.6f %11.6f\n", grid.nx, grid.spacing.x / BOHR_RADIUS, 0.0f, 0.0f);
+    file << line;
+    std::snprintf(line, sizeof(line), "%5d %11.6f %11.6f %11.6f\n", grid.ny, 0.0f, grid.spacing.y / BOHR_RADIUS, 0.0f);
+    file << line;
+    std::snprintf(line, sizeof(line), "%5d %11.6f %11.6f %11.6f\n", grid.nz, 0.0f, 0.0f, grid.spacing.z / BOHR_RADIUS);
+    file << line;
+    std::snprintf(line, sizeof(line), "%5d %11.6f %11.6f %11.6f %11.6f\n", 1, 1.0f, 0.0f, 0.0f, 0.0f);
+    file << line;
+
+    // One slab of rows per x index
+    std::vector<std::string> slabs(grid.nx);
+    parallel_for(grid.nx, 1, [&](size_t begin, size_t end) {
+        char number[32];
+        for (size_t i = begin; i < end; ++i) {
+            std::string& text = slabs[i];
+            text.reserve(static_cast<size_t>(grid.ny) * grid.nz * 14);
+            for (int j = 0; j < grid.ny; ++j) {
+                for (int k = 0; k < grid.nz; ++k) {
+                    int length = std::snprintf(number, sizeof(number), " %12.5E", grid.at(static_cast<int>(i), j, k));
+                    text.append(number, length);
+                    if (k % 6 == 5 || k == grid.nz - 1)
+                        text.push_back('\n');
+                }
+            }
+        }
+    });
+    for (const std::string& text : slabs)
+        file.write(text.data(), text.size());
+    return static_cast<bool>(file);
+}
+
+// Header reader over the mapped text: tokens and line skipping
+struct CubeCursor {
+    const char* p;
+    const char* end;
+
+    void skip_line() {
+        while (p < end && *p != '\n')
+            ++p;
+        if (p < end)
+            ++p;
+    }
+
+    template <typename T>
+    bool next(T& value) {
+        while (p < end && (*p == ' ' || *p == '\t' || *p == '\r'))
+            ++p;
+        auto result = std::from_chars(p, end, value);
+        if (result.ec != std::errc())
+            return false;
+        p = result.ptr;
+        return true;
+    }
+};
+
+// Loads the first dataset of a cube file into an axis-aligned grid. The file
+// is mapped and its value block parsed in parallel chunks straight into the
+// grid, without an intermediate copy of the text. Sheared cells are rejected.
+bool read_cube(const std::string& path, DensityGrid& grid) {
+    MappedFile file(path);
+    if (!file.data())
+        return false;
+    CubeCursor cursor{file.data(), file.data() + file.size()};
+    cursor.skip_line();
+    cursor.skip_line();
+
+    int atoms = 0;
+    float origin[3], axes[3][3];
+    int counts[3];
+    if (!cursor.next(atoms) || !cursor.next(origin[0]) || !cursor.next(origin[1]) || !cursor.next(origin[2]))
+        return false;
+    cursor.skip_line();
+    for (int a = 0; a < 3; ++a) {
+        if (!cursor.next(counts[a]) || !cursor.next(axes[a][0]) || !cursor.next(axes[a][1]) || !cursor.next(axes[a][2]))
+            return false;
+        cursor.skip_line();
+    }
+    for (int a = 0; a < std::abs(atoms); ++a)
+        cursor.skip_line();
+
+    // Negative atom count: a dataset id line follows, values are interleaved per point
+    int per_point = 1;
+    if (atoms < 0) {
+        if (!cursor.next(per_point) || per_point < 1)
+            return false;
+        cursor.skip_line();
+    }
+
+    // Negative counts mean the axis vectors are in angstrom
+    float unit = BOHR_RADIUS;
+    for (int a = 0; a < 3; ++a) {
+        if (counts[a] < 0)
+            unit = BOHR_RADIUS / ANGSTROM_PER_BOHR;
+        counts[a] = std::abs(counts[a]);
+        for (int b = 0; b < 3; ++b)
+            if (b != a && std::fabs(axes[a][b]) > 1e-6f * std::fabs(axes[a][a]))
+                return false;
+        if (counts[a] < 2 || axes[a][a] <= 0.0f)
+            return false;
+    }
+
+    DensityGrid result;
+    result.nx = counts[0];
+    result.ny = counts[1];
+    result.nz = counts[2];
+    result.origin = sf::Vector3f(origin[0] * unit, origin[1] * unit, origin[2] * unit);
+    result.spacing = sf::Vector3f(axes[0][0] * unit, axes[1][1] * unit, axes[2][2] * unit);
+    size_t points = static_cast<size_t>(result.nx) * result.ny * result.nz;
+    result.values.resize(points);
+
+    // Chunks start at whitespace so no number is split; a first pass counts
+    // tokens per chunk, a second parses each chunk at its token offset
+    auto is_space = [](char ch) { return ch == ' ' || ch == '\n' || ch == '\r' || ch == '\t'; };
+    const char* begin = cursor.p;
+    const char* end = cursor.end;
+    size_t chunk_count = std::max<size_t>(1, std::min<size_t>((end - begin) >> 20, 4 * std::thread::hardware_concurrency() + 1));
+    std::vector<const char*> bounds(chunk_count + 1, end);
+    bounds[0] = begin;
+    for (size_t c = 1; c < chunk_count; ++c) {
+        const char* p = std::max(bounds[c - 1], begin + (end - begin) * c / chunk_count);
+        while (p < end && !is_space(*p))
+            ++p;
+        bounds[c] = p;
+    }
+    std::vector<size_t> tokens(chunk_count + 1, 0);
+    parallel_for(chunk_count, 1, [&](size_t first, size_t last) {
+        for (size_t c = first; c < last; ++c) {
+            size_t count = 0;
+            bool in_token = false;
+            for (const char* p = bounds[c]; p < bounds[c + 1]; ++p) {
+                bool token = !is_space(*p);
+                count += token && !in_token;
+                in_token = token;
+            }
+            tokens[c + 1] = count;
+        }
+    });
+    for (size_t c = 0; c < chunk_count; ++c)
+        tokens[c + 1] += tokens[c];
+    if (tokens[chunk_count] < points * per_point)
+        return false;
+
+    std::atomic<bool> failed{false};
+    parallel_for(chunk_count, 1, [&](size_t first, size_t last) {
+        for (size_t c = first; c < last; ++c) {
+            CubeCursor chunk{bounds[c], bounds[c + 1]};
+            for (size_t t = tokens[c]; t < tokens[c + 1] && t < points * per_point; ++t) {
+                while (chunk.p < chunk.end && is_space(*chunk.p))
+                    ++chunk.p;
+                float value;
+                if (!chunk.next(value)) {
+                    failed = true;
+                    return;
+                }
+                if (t % per_point)
+                    continue;
+                // File order is x slowest, z fastest
+                size_t point = t / per_point;
+                int k = static_cast<int>(point % result.nz);
+                int j = static_cast<int>(point / result.nz % result.ny);
+                int i = static_cast<int>(point / result.nz / result.ny);
+                result.values[result.index(i, j, k)] = value;
+            }
+        }
+    });
+    if (failed)
+        return false;
+    grid = std::move(result);
+    return true;
+}
+
+// Reads <stem>.cube, or the compressed <stem>.ocg when there is no cube, which
+// is also kept in compressed (left empty for a cube); path names the file read
+bool read_grid(const std::string& stem, DensityGrid& grid, CompressedGrid& compressed, std::string& path) {
+    compressed = CompressedGrid();
+    path = stem + ".cube";
+    if (read_cube(path, grid))
+        return true;
+    path = stem + ".ocg";
+    if (!load_compressed_grid(path, compressed))
+        return false;
+    grid = decompress_grid(compressed);
+    return true;
+}
+
+// Largest difference between the grid and the analytic psi (or |psi|^2 at
+// t = 0), relative to the analytic peak over the grid
+float grid_deviation(const DensityGrid& grid, const Orbital& orbital, bool signed_psi) {
+    size_t rows = static_cast<size_t>(grid.ny) * grid.nz;
+    std::vector<float> row_error(rows), row_peak(rows);
+    parallel_for(rows, 8, [&](size_t begin, size_t end) {
+        std::vector<float> x(grid.nx), y(grid.nx), z(grid.nx), expected(grid.nx);
+        for (size_t row = begin; row < end; ++row) {
+            int j = static_cast<int>(row % grid.ny), k = static_cast<int>(row / grid.ny);
+            for (int i = 0; i < grid.nx; ++i) {
+                sf::Vector3f p = grid.position(i, j, k);
+                x[i] = p.x;
+                y[i] = p.y;
+                z[i] = p.z;
+            }
+            if (signed_psi)
+                wavefunction_batch(orbital, x.data(), y.data(), z.data(), grid.nx, expected.data());
+            else
+                probability_density_batch(orbital, x.data(), y.data(), z.data(), grid.nx, 0.0f, expected.data());
+            for (int i = 0; i < grid.nx; ++i) {
+                row_error[row] = std::fmax(row_error[row], std::fabs(grid.at(i, j, k) - expected[i]));
+                row_peak[row] = std::fmax(row_peak[row], std::fabs(expected[i]));
+            }
+        }
+    });
+    float error = *std::max_element(row_error.begin(), row_error.end());
+    float peak = *std::max_element(row_peak.begin(), row_peak.end());
+    return peak > 0.0f ? error / peak : 0.0f;
+}
+
+// =======================
+// Grid Alias Sampler
+// =======================
+
+// Walker alias table over n weights (Vose's construction). Entry i keeps
+// itself with probability prob[i] and defers to alias[i] otherwise.
+template <typename Index>
+void build_alias_table(const double* weights, size_t n, float* prob, Index* alias) {
+    double total = 0.0;
+    for (size_t i = 0; i < n; ++i)
+        total += weights[i];
+    if (total <= 0.0) {
+        for (size_t i = 0; i < n; ++i) {
+            prob[i] = 1.0f;
+            alias[i] = static_cast<Index>(i);
+        }
+        return;
+    }
+    std::vector<double> scaled(n);
+    std::vector<Index> small, large;
+    for (size_t i = 0; i < n; ++i) {
+        scaled[i] = weights[i] * n / total;
+        (scaled[i] < 1.0 ? small : large).push_back(static_cast<Index>(i));
+    }
+    while (!small.empty() && !large.empty()) {
+        Index s = small.back(), l = large.back();
+        small.pop_back();
+        prob[s] = static_cast<float>(scaled[s]);
+        alias[s] = l;
+        scaled[l] -= 1.0 - scaled[s];
+        if (scaled[l] < 1.0) {
+            large.pop_back();
+            small.push_back(l);
+        }
+    }
+    // Leftovers are 1 up to rounding
+    for (Index i : large) {
+        prob[i] = 1.0f;
+        alias[i] = i;
+    }
+    for (Index i : small) {
+        prob[i] = 1.0f;
+        alias[i] = i;
+    }
+}
+
+// Rejection-free sampling of a tabulated density. Cells are grouped into 8^3
+// blocks, each with its own alias table (built in parallel), and a top-level
+// table picks the block, so a sample costs two table lookups. Nearest mode
+// treats each voxel as a constant box around its center. Trilinear mode
+// samples the interpolated density over the cells between voxel centers
+// exactly: a corner is chosen by weight, then each axis from a linear ramp.
+constexpr int ALIAS_BLOCK = 8;
+constexpr int ALIAS_BLOCK_CELLS = ALIAS_BLOCK * ALIAS_BLOCK * ALIAS_BLOCK;
+
+class GridSampler {
+public:
+    GridSampler(const DensityGrid& grid, bool trilinear) : grid_(grid), trilinear_(trilinear) {
+        int shrink = trilinear ? 1 : 0;
+        cells_[0] = grid.nx - shrink;
+        cells_[1] = grid.ny - shrink;
+        cells_[2] = grid.nz - shrink;
+        for (int a = 0; a < 3; ++a)
+            blocks_[a] = (cells_[a] + ALIAS_BLOCK - 1) / ALIAS_BLOCK;
+        size_t block_count = static_cast<size_t>(blocks_[0]) * blocks_[1] * blocks_[2];
+        prob_.resize(block_count * ALIAS_BLOCK_CELLS);
+        alias_.resize(block_count * ALIAS_BLOCK_CELLS);
+        std::vector<double> block_mass(block_count);
+
+        parallel_for(block_count, 1, [&](size_t begin, size_t end) {
+            std::vector<double> mass(ALIAS_BLOCK_CELLS);
+            for (size_t b = begin; b < end; ++b) {
+                int origin[3] = {static_cast<int>(b % blocks_[0]) * ALIAS_BLOCK,
+                                 static_cast<int>(b / blocks_[0] % blocks_[1]) * ALIAS_BLOCK,
+                                 static_cast<int>(b / blocks_[0] / blocks_[1]) * ALIAS_BLOCK};
+                double total = 0.0;
+                for (int c = 0; c < ALIAS_BLOCK_CELLS; ++c) {
+                    int i = origin[0] + c % ALIAS_BLOCK;
+                    int j = origin[1] + c / ALIAS_BLOCK % ALIAS_BLOCK;
+                    int k = origin[2] + c / (ALIAS_BLOCK * ALIAS_BLOCK);
+                    mass[c] = i < cells_[0] && j < cells_[1] && k < cells_[2] ? cell_mass(i, j, k) : 0.0;
+                    total += mass[c];
+                }
+                block_mass[b] = total;
+                build_alias_table(mass.data(), ALIAS_BLOCK_CELLS, &prob_[b * ALIAS_BLOCK_CELLS], &alias_[b * ALIAS_BLOCK_CELLS]);
+            }
+        });
+
+        block_prob_.resize(block_count);
+        block_alias_.resize(block_count);
+        build_alias_table(block_mass.data(), block_count, block_prob_.data(), block_alias_.data());
+        for (double mass : block_mass)
+            total_mass_ += mass;
+    }
+
+    bool empty() const { return total_mass_ <= 0.0; }
+
+    sf::Vector3f sample(std::mt19937& gen) const {
+        std::uniform_real_distribution<float> unit_dist(0.0f, 1.0f);
+        size_t block = pick(block_prob_.data(), block_alias_.data(), block_prob_.size(), unit_dist(gen));
+        size_t base = block * ALIAS_BLOCK_CELLS;
+        size_t local = pick(&prob_[base], &alias_[base], ALIAS_BLOCK_CELLS, unit_dist(gen));
+
+        int cell[3] = {static_cast<int>(block % blocks_[0]) * ALIAS_BLOCK + static_cast<int>(local % ALIAS_BLOCK),
+                       static_cast<int>(block / blocks_[0] % blocks_[1]) * ALIAS_BLOCK + static_cast<int>(local / ALIAS_BLOCK % ALIAS_BLOCK),
+                       static_cast<int>(block / blocks_[0] / blocks_[1]) * ALIAS_BLOCK + static_cast<int>(local / (ALIAS_BLOCK * ALIAS_BLOCK))};
+        float t[3];
+        if (trilinear_) {
+            // Corner by weight, then each axis from the ramp toward that corner
+            float weights[8], total = 0.0f;
+            for (int c = 0; c < 8; ++c) {
+                weights[c] = std::fmax(grid_.at(cell[0] + (c & 1), cell[1] + (c >> 1 & 1), cell[2] + (c >> 2)), 0.0f);
+                total += weights[c];
+            }
+            float u = unit_dist(gen) * total;
+            int corner = 7;
+            for (int c = 0; c < 7; ++c) {
+                if (u < weights[c]) {
+                    corner = c;
+                    break;
+                }
+                u -= weights[c];
+            }
+            for (int a = 0; a < 3; ++a) {
+                float ramp = std::sqrt(unit_dist(gen));
+                t[a] = corner >> a & 1 ? ramp : 1.0f - ramp;
+            }
+        } else {
+            for (int a = 0; a < 3; ++a)
+                t[a] = unit_dist(gen) - 0.5f;
+        }
+        sf::Vector3f p = grid_.position(cell[0], cell[1], cell[2]);
+        return sf::Vector3f(p.x + t[0] * grid_.spacing.x, p.y + t[1] * grid_.spacing.y, p.z + t[2] * grid_.spacing.z);
+    }
+
+    // Parallel batch; every worker chunk gets its own generator derived from seed
+    std::vector<sf::Vector3f> generate(size_t count, unsigned seed) const {
+        std::vector<sf::Vector3f> points(count);
+        if (empty())
+            return {};
+        constexpr size_t GRAIN = 4096;
+        parallel_for(count, GRAIN, [&](size_t begin, size_t end) {
+            std::mt19937 gen(seed ^ static_cast<unsigned>(begin / GRAIN * 0x9E3779B9u));
+            for (size_t i = begin; i < end; ++i)
+                points[i] = sample(gen);
+        });
+        return points;
+    }
+
+private:
+    double cell_mass(int i, int j, int k) const {
+        if (!trilinear_)
+            return std::fmax(grid_.at(i, j, k), 0.0f);
+        double sum = 0.0;
+        for (int c = 0; c < 8; ++c)
+            sum += std::fmax(grid_.at(i + (c & 1), j + (c >> 1 & 1), k + (c >> 2)), 0.0f);
+        return sum / 8.0; // Integral of the trilinear interpolant over the cell
+    }
+
+    template <typename Index>
+    static size_t pick(const float* prob, const Index* alias, size_t n, float u) {
+        float scaled = u * n;
+        size_t i = std::min(static_cast<size_t>(scaled), n - 1);
+        return scaled - i < prob[i] ? i : alias[i];
+    }
+
+    const DensityGrid& grid_;
+    bool trilinear_;
+    int cells_[3], blocks_[3];
+    std::vector<float> prob_;
+    std::vector<std::uint16_t> alias_; // Local to the block
+    std::vector<float> block_prob_;
+    std::vector<std::uint32_t> block_alias_;
+    double total_mass_ = 0.0;
 };
 
 // =======================
-// Quantum Functions
+// Superposition States
 // =======================
 
-// Real spherical harmonics for s and p orbitals
-float real_spherical_harmonic(const Orbital& orbital, float theta, float phi) {
-    int l = orbital.l;
-    int m = orbital.m;
+// Hydrogen-like energy -Z^2 mu / 2n^2 in hartree (atomic units, hbar = 1)
+float orbital_energy(const Orbital& orbital) {
+    const Species& species = orbital.species;
+    return -0.5f * species.charge * species.charge * species.reduced_mass / (orbital.n * orbital.n);
+}
 
-    if (l == 0 && m == 0) // 1s
-        return 0.5f * std::sqrt(1.0f / PI);
+struct Superposition {
+    std::vector<Orbital> basis;
+    std::vector<std::complex<float>> coefficients; // Normalized, at t = 0
 
-    if (l == 1 && m == 0) // 2pz
-        return std::sqrt(3.0f / (4.0f * PI)) * std::cos(theta);
+    // Psi(t) = sum_k c_k e^{-i E_k t} psi_k
+    std::vector<std::complex<float>> phases(float time) const {
+        std::vector<std::complex<float>> result(basis.size());
+        phases(time, result.data());
+        return result;
+    }
 
-    if (l == 1 && m == 1) // 2px
-        return -std::sqrt(3.0f / (4.0f * PI)) * std::sin(theta) * std::cos(phi);
+    void phases(float time, std::complex<float>* out) const {
+        for (size_t k = 0; k < basis.size(); ++k)
+            out[k] = coefficients[k] * std::polar(1.0f, -orbital_energy(basis[k]) * time);
+    }
+};
 
-    if (l == 1 && m == -1) // 2py
-        return -std::sqrt(3.0f / (4.0f * PI)) * std::sin(theta) * std::sin(phi);
+// Equal-weight superposition of the given states
+Superposition make_superposition(const std::vector<Orbital>& basis) {
+    Superposition state;
+    state.basis = basis;
+    state.coefficients.assign(basis.size(), std::complex<float>(1.0f / std::sqrt(static_cast<float>(basis.size())), 0.0f));
+    return state;
+}
+
+// Point cloud of |Psi(t)|^2 for a superposition. Points are drawn once from
+// the time-averaged density sum_k |c_k|^2 psi_k^2, and every basis psi is
+// cached at them. By Cauchy-Schwarz |Psi(t)|^2 <= N * average, so each frame
+// keeping point i when u_i * N * average_i < |Psi_i(t)|^2 (with a fixed u_i)
+// is an exact rejection sample of the evolved density. A frame only
+// recombines the cached values with the current phases.
+class SuperpositionCloud {
+public:
+    void build(const Superposition& state, size_t count, std::mt19937& gen) {
+        state_ = state;
+        size_t basis_count = state.basis.size();
+        std::vector<double> weights(basis_count);
+        for (size_t k = 0; k < basis_count; ++k)
+            weights[k] = std::norm(state.coefficients[k]);
+        std::discrete_distribution<size_t> pick(weights.begin(), weights.end());
+        std::uniform_real_distribution<float> unit_dist(0.0f, 1.0f);
+
+        // Mixture draw: how many points come from each basis state
+        std::vector<size_t> per_basis(basis_count, 0);
+        for (size_t i = 0; i < count; ++i)
+            ++per_basis[pick(gen)];
+        x_.clear();
+        y_.clear();
+        z_.clear();
+        for (size_t k = 0; k < basis_count; ++k) {
+            for (const sf::Vector3f& p : generate_orbital_points(state.basis[k], per_basis[k], gen)) {
+                x_.push_back(p.x);
+                y_.push_back(p.y);
+                z_.push_back(p.z);
+            }
+        }
+        count = x_.size();
+
+        psi_.assign(basis_count * count, 0.0f);
+        parallel_for(count, 4096, [&](size_t begin, size_t end) {
+            for (size_t k = 0; k < basis_count; ++k)
+                wavefunction_batch(state.basis[k], &x_[begin], &y_[begin], &z_[begin], end - begin, &psi_[k * count + begin]);
+        });
+        threshold_.resize(count);
+        for (size_t i = 0; i < count; ++i) {
+            float average = 0.0f;
+            for (size_t k = 0; k < basis_count; ++k)
+                average += static_cast<float>(weights[k]) * psi_[k * count + i] * psi_[k * count + i];
+            threshold_[i] = unit_dist(gen) * basis_count * average;
+        }
+        keep_.resize(count);
+    }
+
+    // Points of the cloud at this time (in place of a resample)
+    const std::vector<sf::Vector3f>& evaluate(float time) {
+        std::vector<std::complex<float>> phases = state_.phases(time * SUPERPOSITION_TIME_SCALE);
+        size_t count = x_.size(), basis_count = phases.size();
+        parallel_for(count, 4096, [&](size_t begin, size_t end) {
+            for (size_t i = begin; i < end; ++i) {
+                float re = 0.0f, im = 0.0f;
+                for (size_t k = 0; k < basis_count; ++k) {
+                    float psi = psi_[k * count + i];
+                    re += phases[k].real() * psi;
+                    im += phases[k].imag() * psi;
+                }
+                keep_[i] = threshold_[i] < re * re + im * im;
+            }
+        });
+        points_.clear();
+        for (size_t i = 0; i < count; ++i)
+            if (keep_[i])
+                points_.emplace_back(x_[i], y_[i], z_[i]);
+        return points_;
+    }
+
+    bool empty() const { return x_.empty(); }
+
+private:
+    Superposition state_;
+    std::vector<float> x_, y_, z_;
+    std::vector<float> psi_;       // basis-major: psi_[k * count + i]
+    std::vector<float> threshold_; // u_i * N * time-averaged density
+    std::vector<std::uint8_t> keep_;
+    std::vector<sf::Vector3f> points_;
+};
+
+// =======================
+// Bohmian Trajectories
+// =======================
+
+// Points carried by the probability current, v = Im(grad Psi / Psi) (atomic
+// units). A cloud drawn from |Psi(0)|^2 stays distributed as |Psi(t)|^2 by the
+// continuity equation, so a frame costs one RK4 step per point and never
+// resamples. Points are kept in SoA arrays and stepped a block of lanes at a
+// time, every velocity evaluation going through OrbitalKernel::gradient_block.
+// A point whose step would move it far relative to its radius (near a node,
+// where v diverges) leaves the block for a separate pass that splits it into a
+// power-of-two number of substeps. The phases at every half substep of every
+// split are tabulated once per step.
+constexpr int BOHM_SPLIT_LEVELS = 7; // Splits into 1, 2, 4, ... substeps
+constexpr int BOHM_MAX_SUBSTEPS = 1 << (BOHM_SPLIT_LEVELS - 1);
+
+class BohmianCloud {
+public:
+    void build(const Superposition& state, bool complex_form, size_t count, std::mt19937& gen) {
+        state_ = state;
+        complex_form_ = complex_form;
+        kernels_.clear();
+        for (const Orbital& orbital : state.basis)
+            kernels_.emplace_back(orbital);
+        x_.clear();
+        y_.clear();
+        z_.clear();
+
+        // Mixture proposals accepted with |Psi(0)|^2 / (N * average), as in SuperpositionCloud
+        size_t basis_count = state.basis.size();
+        std::vector<double> weights(basis_count);
+        for (size_t k = 0; k < basis_count; ++k)
+            weights[k] = std::norm(state.coefficients[k]);
+        std::discrete_distribution<size_t> pick(weights.begin(), weights.end());
+        std::uniform_real_distribution<float> unit_dist(0.0f, 1.0f);
+        std::vector<std::complex<float>> phases = state.phases(0.0f);
+        std::vector<const TabulatedCdf*> radial(basis_count), polar(basis_count);
+        for (size_t k = 0; k < basis_count; ++k) {
+            const Orbital& orbital = state.basis[k];
+            radial[k] = &radial_cdf(orbital.n, orbital.l, orbital.species);
+            polar[k] = &polar_cdf(orbital.l, std::abs(orbital.m));
+        }
+        while (x_.size() < count) {
+            size_t k = pick(gen);
+            sf::Vector3f p = sample_orbital_point(state.basis[k], *radial[k], *polar[k], gen, complex_form);
+            std::complex<float> psi(0.0f, 0.0f), grad[3];
+            float average = 0.0f;
+            for (size_t b = 0; b < basis_count; ++b) {
+                std::complex<float> value;
+                kernels_[b].gradient(p.x, p.y, p.z, complex_form, value, grad);
+                psi += phases[b] * value;
+                average += static_cast<float>(weights[b]) * std::norm(value);
+            }
+            if (unit_dist(gen) * basis_count * average < std::norm(psi)) {
+                x_.push_back(p.x);
+                y_.push_back(p.y);
+                z_.push_back(p.z);
+            }
+        }
+    }
+
+    // Advances every point from time to time + dt (both in atomic units)
+    void advance(float time, float dt) {
+        size_t stride = state_.basis.size();
+        phases_.resize(SUBSTEP_PHASES * stride);
+        std::complex<float>* out = phases_.data();
+        for (int substeps = 1; substeps <= BOHM_MAX_SUBSTEPS; substeps *= 2)
+            for (int j = 0; j <= 2 * substeps; ++j, out += stride)
+                state_.phases(time + 0.5f * dt * j / substeps, out);
+        parallel_for(x_.size(), KERNEL_LANES, [&](size_t first, size_t last) {
+            for (size_t begin = first; begin < last; begin += KERNEL_LANES)
+                step_block(begin, std::min(KERNEL_LANES, last - begin), dt);
+        });
+    }
+
+    size_t size() const { return x_.size(); }
+    sf::Vector3f point(size_t i) const { return sf::Vector3f(x_[i], y_[i], z_[i]); }
+    bool empty() const { return x_.empty(); }
+
+private:
+    using Phases = const std::complex<float>*; // One per basis state
+
+    // Tabulated phase sets: 2s + 1 for each split into s = 1, 2, 4, ... substeps
+    static constexpr int SUBSTEP_PHASES = 4 * BOHM_MAX_SUBSTEPS - 2 + BOHM_SPLIT_LEVELS;
+
+    void velocity(float x, float y, float z, Phases phases, float* v) const {
+        std::complex<float> psi(0.0f, 0.0f), grad[3] = {}, value, basis_grad[3];
+        for (size_t k = 0; k < kernels_.size(); ++k) {
+            kernels_[k].gradient(x, y, z, complex_form_, value, basis_grad);
+            psi += phases[k] * value;
+            for (int a = 0; a < 3; ++a)
+                grad[a] += phases[k] * basis_grad[a];
+        }
+        // v = Im(grad psi / psi) / mu
+        float density = std::norm(psi), mu = state_.basis[0].species.reduced_mass;
+        for (int a = 0; a < 3; ++a)
+            v[a] = density > 0.0f ? (std::conj(psi) * grad[a]).imag() / (mu * density) : 0.0f;
+    }
+
+    // velocity() at a block of lanes, the complex sums in real arithmetic
+    void velocity_block(const float* x, const float* y, const float* z, size_t lanes, Phases phases, float (*v)[KERNEL_LANES]) const {
+        float psi_re[KERNEL_LANES] = {}, psi_im[KERNEL_LANES] = {}, grad_re[3][KERNEL_LANES] = {}, grad_im[3][KERNEL_LANES] = {};
+        OrbitalKernel::GradientLanes basis;
+        for (size_t k = 0; k < kernels_.size(); ++k) {
+            kernels_[k].gradient_block(x, y, z, lanes, complex_form_, basis);
+            float cr = phases[k].real(), ci = phases[k].imag();
+            for (size_t i = 0; i < lanes; ++i) {
+                psi_re[i] += cr * basis.psi_re[i] - ci * basis.psi_im[i];
+                psi_im[i] += cr * basis.psi_im[i] + ci * basis.psi_re[i];
+            }
+            for (int a = 0; a < 3; ++a)
+                for (size_t i = 0; i < lanes; ++i) {
+                    grad_re[a][i] += cr * basis.grad_re[a][i] - ci * basis.grad_im[a][i];
+                    grad_im[a][i] += cr * basis.grad_im[a][i] + ci * basis.grad_re[a][i];
+                }
+        }
+        float mu = state_.basis[0].species.reduced_mass;
+        for (size_t i = 0; i < lanes; ++i) {
+            float density = psi_re[i] * psi_re[i] + psi_im[i] * psi_im[i];
+            int nonzero = density > 0.0f; // Zero velocity on a node, without a select
+            float inv = nonzero / (mu * density + (1 - nonzero));
+            for (int a = 0; a < 3; ++a)
+                v[a][i] = (psi_re[i] * grad_im[a][i] - psi_im[i] * grad_re[a][i]) * inv;
+        }
+    }
+
+    void rk4(float& x, float& y, float& z, float h, const float* k1, Phases mid, Phases end) const {
+        float k2[3], k3[3], k4[3];
+        velocity(x + 0.5f * h * k1[0], y + 0.5f * h * k1[1], z + 0.5f * h * k1[2], mid, k2);
+        velocity(x + 0.5f * h * k2[0], y + 0.5f * h * k2[1], z + 0.5f * h * k2[2], mid, k3);
+        velocity(x + h * k3[0], y + h * k3[1], z + h * k3[2], end, k4);
+        x += h / 6.0f * (k1[0] + 2.0f * k2[0] + 2.0f * k3[0] + k4[0]);
+        y += h / 6.0f * (k1[1] + 2.0f * k2[1] + 2.0f * k3[1] + k4[1]);
+        z += h / 6.0f * (k1[2] + 2.0f * k2[2] + 2.0f * k3[2] + k4[2]);
+    }
+
+    // rk4() across a block of lanes
+    void rk4_block(float* x, float* y, float* z, size_t lanes, float h, float (*k1)[KERNEL_LANES], Phases mid, Phases end) const {
+        float px[KERNEL_LANES], py[KERNEL_LANES], pz[KERNEL_LANES];
+        float k2[3][KERNEL_LANES], k3[3][KERNEL_LANES], k4[3][KERNEL_LANES];
+        auto probe = [&](float (*k)[KERNEL_LANES], float t) {
+            for (size_t i = 0; i < lanes; ++i) {
+                px[i] = x[i] + t * k[0][i];
+                py[i] = y[i] + t * k[1][i];
+                pz[i] = z[i] + t * k[2][i];
+            }
+        };
+        probe(k1, 0.5f * h);
+        velocity_block(px, py, pz, lanes, mid, k2);
+        probe(k2, 0.5f * h);
+        velocity_block(px, py, pz, lanes, mid, k3);
+        probe(k3, h);
+        velocity_block(px, py, pz, lanes, end, k4);
+        float w = h / 6.0f;
+        for (size_t i = 0; i < lanes; ++i) {
+            x[i] += w * (k1[0][i] + 2.0f * k2[0][i] + 2.0f * k3[0][i] + k4[0][i]);
+            y[i] += w * (k1[1][i] + 2.0f * k2[1][i] + 2.0f * k3[1][i] + k4[1][i]);
+            z[i] += w * (k1[2][i] + 2.0f * k2[2][i] + 2.0f * k3[2][i] + k4[2][i]);
+        }
+    }
+
+    // Steps points begin..begin + lanes. Those whose step stays within reach
+    // are packed together for rk4_block; the rest take the substep pass.
+    void step_block(size_t begin, size_t lanes, float dt) {
+        Phases split = phases_.data(); // Start, middle and end of the whole step
+        size_t stride = kernels_.size();
+        float k1[3][KERNEL_LANES];
+        velocity_block(&x_[begin], &y_[begin], &z_[begin], lanes, split, k1);
+
+        float x[KERNEL_LANES], y[KERNEL_LANES], z[KERNEL_LANES], packed_k1[3][KERNEL_LANES];
+        size_t packed[KERNEL_LANES], regular = 0;
+        for (size_t i = 0; i < lanes; ++i) {
+            size_t p = begin + i;
+            float speed = std::sqrt(k1[0][i] * k1[0][i] + k1[1][i] * k1[1][i] + k1[2][i] * k1[2][i]);
+            float reach = 0.05f * (std::sqrt(x_[p] * x_[p] + y_[p] * y_[p] + z_[p] * z_[p]) + kernels_[0].a0);
+            if (speed * dt > reach) {
+                float v[3] = {k1[0][i], k1[1][i], k1[2][i]};
+                split_point(x_[p], y_[p], z_[p], v, speed * dt / reach, dt);
+                continue;
+            }
+            x[regular] = x_[p];
+            y[regular] = y_[p];
+            z[regular] = z_[p];
+            for (int a = 0; a < 3; ++a)
+                packed_k1[a][regular] = k1[a][i];
+            packed[regular++] = p;
+        }
+        rk4_block(x, y, z, regular, dt, packed_k1, split + stride, split + 2 * stride);
+        for (size_t j = 0; j < regular; ++j) {
+            x_[packed[j]] = x[j];
+            y_[packed[j]] = y[j];
+            z_[packed[j]] = z[j];
+        }
+    }
+
+    // Near a node: ratio = speed * dt / reach substeps, rounded up to the next tabulated split
+    void split_point(float& x, float& y, float& z, float* k1, float ratio, float dt) const {
+        size_t stride = kernels_.size();
+        Phases split = phases_.data();
+        int needed = std::min(BOHM_MAX_SUBSTEPS, static_cast<int>(std::ceil(ratio)));
+        int substeps = 1;
+        for (; substeps < needed; substeps *= 2)
+            split += (2 * substeps + 1) * stride;
+        float h = dt / substeps;
+        for (int s = 0; s < substeps; ++s) {
+            Phases start = split + 2 * s * stride;
+            if (s > 0)
+                velocity(x, y, z, start, k1);
+            rk4(x, y, z, h, k1, start + stride, start + 2 * stride);
+        }
+    }
 
-    return 0.0f; // Unimplemented
+    Superposition state_;
+    bool complex_form_ = false;
+    std::vector<OrbitalKernel> kernels_;
+    std::vector<float> x_, y_, z_;
+    std::vector<std::complex<float>> phases_; // SUBSTEP_PHASES sets, written by advance
+};
+
+// =======================
+// Langevin Sampler
+// =======================
+
+// Log density and its gradient at count points: (x, y, z, count, logp, gx, gy, gz)
+using LogDensityGradFn = std::function<void(const float*, const float*, const float*, size_t, float*, float*, float*, float*)>;
+
+// log |psi|^2 and its gradient 2 grad psi / psi; -inf with zero gradient on nodes
+LogDensityGradFn orbital_log_density(const Orbital& orbital) {
+    OrbitalKernel kernel(orbital);
+    return [kernel](const float* x, const float* y, const float* z, size_t count, float* logp, float* gx, float* gy, float* gz) {
+        for (size_t i = 0; i < count; ++i) {
+            float grad[3];
+            logp[i] = 2.0f * kernel.log_gradient(x[i], y[i], z[i], grad);
+            gx[i] = 2.0f * grad[0];
+            gy[i] = 2.0f * grad[1];
+            gz[i] = 2.0f * grad[2];
+        }
+    };
 }
 
-float radial_function(int n, float r) {
-    float a0 = BOHR_RADIUS;
+// Metropolis-adjusted Langevin over many chains at once. Each iteration
+// proposes x' = x + (eps^2 / 2) grad log p + eps xi for every chain, evaluates
+// all proposals in one batch per worker chunk, and applies the MH correction.
+// The drift is truncated to at most eps (MALTA), since grad log |psi|^2
+// diverges at nodes and would otherwise fling chains out of reach.
+// Without the gradient it is random-walk Metropolis, kept for comparison. When
+// the target is even in x, y and z (every real orbital density is), random
+// reflections move chains between lobes that nodal planes separate.
+constexpr size_t LANGEVIN_CHUNK = 64; // Chains per worker chunk, each with its own generator
+constexpr float LANGEVIN_TARGET_ACCEPTANCE = 0.574f;
 
-    if (n == 1) // 1s
-        return 2.0f * std::exp(-r / a0) / std::pow(a0, 1.5f);
+class LangevinSampler {
+public:
+    LangevinSampler(LogDensityGradFn target, size_t chains, float initial_radius, float step, bool use_gradient, bool reflect, unsigned seed)
+        : target_(std::move(target)), chains_(chains), step_(step), use_gradient_(use_gradient), reflect_(reflect),
+          x_(chains), y_(chains), z_(chains), logp_(chains), gx_(chains), gy_(chains), gz_(chains) {
+        for (size_t c = 0; c < (chains + LANGEVIN_CHUNK - 1) / LANGEVIN_CHUNK; ++c)
+            gens_.emplace_back(seed + static_cast<unsigned>(c) * 7919u);
+        std::mt19937& gen = gens_[0];
+        std::normal_distribution<float> normal(0.0f, 1.0f);
+        std::uniform_real_distribution<float> unit_dist(0.0f, 1.0f);
+        for (size_t i = 0; i < chains; ++i) {
+            float r = initial_radius * unit_dist(gen), dx = normal(gen), dy = normal(gen), dz = normal(gen);
+            float inv = r / std::fmax(std::sqrt(dx * dx + dy * dy + dz * dz), 1e-20f);
+            x_[i] = dx * inv;
+            y_[i] = dy * inv;
+            z_[i] = dz * inv;
+        }
+        target_(x_.data(), y_.data(), z_.data(), chains, logp_.data(), gx_.data(), gy_.data(), gz_.data());
+    }
+
+    // Runs iterations on every chain. With adapt, the step size is tuned toward
+    // the optimal MALA acceptance (use for burn-in only). With trace, the
+    // value of statistic at every chain is appended per iteration.
+    void run(size_t iterations, bool adapt, std::vector<float>* trace = nullptr,
+             const std::function<float(float, float, float)>& statistic = nullptr) {
+        for (size_t it = 0; it < iterations; ++it) {
+            std::atomic<size_t> accepted{0};
+            float step = step_;
+            parallel_for(chains_, LANGEVIN_CHUNK, [&](size_t begin, size_t end) {
+                for (size_t chunk = begin; chunk < end; chunk += LANGEVIN_CHUNK)
+                    accepted += advance_chunk(chunk, std::min(end, chunk + LANGEVIN_CHUNK), step);
+            });
+            float rate = static_cast<float>(accepted) / chains_;
+            total_accepted_ += accepted;
+            total_proposed_ += chains_;
+            if (adapt)
+                step_ *= std::exp(0.5f * (rate - (use_gradient_ ? LANGEVIN_TARGET_ACCEPTANCE : 0.234f)));
+            if (trace)
+                for (size_t i = 0; i < chains_; ++i)
+                    trace->push_back(statistic(x_[i], y_[i], z_[i]));
+        }
+    }
+
+    float acceptance() const { return total_proposed_ ? static_cast<float>(total_accepted_) / total_proposed_ : 0.0f; }
+    void reset_acceptance() { total_accepted_ = total_proposed_ = 0; }
+    float step() const { return step_; }
+    size_t chains() const { return chains_; }
+    sf::Vector3f point(size_t i) const { return sf::Vector3f(x_[i], y_[i], z_[i]); }
 
-    if (n == 2) // 2s or 2p
-        return (1.0f / (2.0f * std::sqrt(2.0f))) * (1.0f - r / (2.0f * a0)) * std::exp(-r / (2.0f * a0)) / std::pow(a0, 1.5f);
+private:
+    size_t advance_chunk(size_t begin, size_t end, float step) {
+        std::mt19937& gen = gens_[begin / LANGEVIN_CHUNK];
+        std::normal_distribution<float> normal(0.0f, 1.0f);
+        std::uniform_real_distribution<float> unit_dist(0.0f, 1.0f);
+        size_t size = end - begin;
+        float drift_scale = use_gradient_ ? 0.5f * step * step : 0.0f;
+        // Drift vector, truncated to length step
+        auto drift = [&](float gx, float gy, float gz, float* d) {
+            float length = drift_scale * std::sqrt(gx * gx + gy * gy + gz * gz);
+            float scale = length > step ? drift_scale * step / length : drift_scale;
+            d[0] = scale * gx;
+            d[1] = scale * gy;
+            d[2] = scale * gz;
+        };
+        float px[LANGEVIN_CHUNK], py[LANGEVIN_CHUNK], pz[LANGEVIN_CHUNK];
+        float plogp[LANGEVIN_CHUNK], pgx[LANGEVIN_CHUNK], pgy[LANGEVIN_CHUNK], pgz[LANGEVIN_CHUNK];
+        float forward[LANGEVIN_CHUNK][3];
+        for (size_t k = 0; k < size; ++k) {
+            size_t i = begin + k;
+            drift(gx_[i], gy_[i], gz_[i], forward[k]);
+            px[k] = x_[i] + forward[k][0] + step * normal(gen);
+            py[k] = y_[i] + forward[k][1] + step * normal(gen);
+            pz[k] = z_[i] + forward[k][2] + step * normal(gen);
+        }
+        target_(px, py, pz, size, plogp, pgx, pgy, pgz);
+
+        size_t accepted = 0;
+        float inv_var = 1.0f / (2.0f * step * step);
+        for (size_t k = 0; k < size; ++k) {
+            size_t i = begin + k;
+            float log_ratio = plogp[k] - logp_[i];
+            if (use_gradient_) {
+                // log q(x | x') - log q(x' | x)
+                float backward[3];
+                drift(pgx[k], pgy[k], pgz[k], backward);
+                float bx = x_[i] - px[k] - backward[0], by = y_[i] - py[k] - backward[1], bz = z_[i] - pz[k] - backward[2];
+                float fx = px[k] - x_[i] - forward[k][0], fy = py[k] - y_[i] - forward[k][1], fz = pz[k] - z_[i] - forward[k][2];
+                log_ratio += ((fx * fx + fy * fy + fz * fz) - (bx * bx + by * by + bz * bz)) * inv_var;
+            }
+            if (plogp[k] > -INFINITY && std::log(unit_dist(gen)) < log_ratio) {
+                x_[i] = px[k];
+                y_[i] = py[k];
+                z_[i] = pz[k];
+                logp_[i] = plogp[k];
+                gx_[i] = pgx[k];
+                gy_[i] = pgy[k];
+                gz_[i] = pgz[k];
+                ++accepted;
+            }
+            if (reflect_) {
+                // Density-preserving, so always accepted; the gradient flips with the coordinate
+                if (gen() & 1) { x_[i] = -x_[i]; gx_[i] = -gx_[i]; }
+                if (gen() & 1) { y_[i] = -y_[i]; gy_[i] = -gy_[i]; }
+                if (gen() & 1) { z_[i] = -z_[i]; gz_[i] = -gz_[i]; }
+            }
+        }
+        return accepted;
+    }
+
+    LogDensityGradFn target_;
+    size_t chains_;
+    float step_;
+    bool use_gradient_, reflect_;
+    std::vector<float> x_, y_, z_, logp_, gx_, gy_, gz_;
+    std::vector<std::mt19937> gens_;
+    size_t total_accepted_ = 0, total_proposed_ = 0;
+};
 
-    return 0.0f; // Unimplemented
+// Effective sample size of a multi-chain trace (trace[t * chains + c]) from
+// the chain-averaged autocorrelation, truncated by Geyer's initial positive
+// sequence: ESS = chains * length / (1 + 2 sum rho_k)
+double effective_sample_size(const std::vector<float>& trace, size_t chains) {
+    size_t length = trace.size() / chains;
+    if (length < 4)
+        return 0.0;
+    double mean = 0.0;
+    for (float value : trace)
+        mean += value;
+    mean /= trace.size();
+    auto autocovariance = [&](size_t lag) {
+        double sum = 0.0;
+        for (size_t t = 0; t + lag < length; ++t)
+            for (size_t c = 0; c < chains; ++c)
+                sum += (trace[t * chains + c] - mean) * (trace[(t + lag) * chains + c] - mean);
+        return sum / ((length - lag) * chains);
+    };
+    double variance = autocovariance(0);
+    if (variance <= 0.0)
+        return static_cast<double>(trace.size());
+    double tau = 1.0;
+    for (size_t lag = 1; lag + 1 < length; lag += 2) {
+        double pair = (autocovariance(lag) + autocovariance(lag + 1)) / variance;
+        if (pair <= 0.0)
+            break;
+        tau += 2.0 * pair;
+    }
+    return trace.size() / tau;
 }
 
-float probability_density(const Orbital& orbital, float r, float theta, float phi, float time) {
-    float R = radial_function(orbital.n, r);
-    float Y = real_spherical_harmonic(orbital, theta, phi);
-    float psi = R * Y;
-    float vibration = 1.0f + 0.1f * std::sin(VIBRATION_FREQ * time);
-    return psi * psi * vibration;
+// =======================
+// Progressive Generation
+// =======================
+
+// Lock-free single-producer / single-consumer ring buffer
+template <typename T, size_t Capacity>
+class SpscQueue {
+    static_assert((Capacity & (Capacity - 1)) == 0, "Capacity must be a power of two");
+
+public:
+    bool push(T&& value) {
+        size_t tail = tail_.load(std::memory_order_relaxed);
+        if (tail - head_.load(std::memory_order_acquire) == Capacity)
+            return false; // Full
+        slots_[tail & (Capacity - 1)] = std::move(value);
+        tail_.store(tail + 1, std::memory_order_release);
+        return true;
+    }
+
+    bool pop(T& value) {
+        size_t head = head_.load(std::memory_order_relaxed);
+        if (head == tail_.load(std::memory_order_acquire))
+            return false; // Empty
+        value = std::move(slots_[head & (Capacity - 1)]);
+        head_.store(head + 1, std::memory_order_release);
+        return true;
+    }
+
+private:
+    std::array<T, Capacity> slots_;
+    alignas(64) std::atomic<size_t> head_{0};
+    alignas(64) std::atomic<size_t> tail_{0};
+};
+
+// Samples on a worker thread and publishes the cloud in chunks, so the render
+// loop can show the first points immediately and densify over the next frames.
+class ProgressiveSampler {
+public:
+    ~ProgressiveSampler() { stop(); }
+
+    void start(const Orbital& orbital, size_t target) {
+        stop();
+        running_ = true;
+        worker_ = std::thread([this, orbital, target]() {
+            std::random_device rd;
+            std::mt19937 gen(rd());
+            size_t produced = 0;
+            size_t chunk_size = PROGRESSIVE_FIRST_CHUNK;
+            while (running_ && produced < target) {
+                size_t count = std::min(chunk_size, target - produced);
+                chunk_size = std::min<size_t>(chunk_size * 2, PROGRESSIVE_CHUNK_SIZE);
+                auto begin = std::chrono::steady_clock::now();
+                std::vector<sf::Vector3f> chunk = generate_orbital_points(orbital, count, gen);
+                auto elapsed = std::chrono::steady_clock::now() - begin;
+                generation_us_ += std::chrono::duration_cast<std::chrono::microseconds>(elapsed).count();
+                generated_ += count;
+                while (!queue_.push(std::move(chunk))) {
+                    if (!running_)
+                        return;
+                    std::this_thread::yield();
+                }
+                produced += count;
+            }
+        });
+    }
+
+    void stop() {
+        running_ = false;
+        if (worker_.joinable())
+            worker_.join();
+        std::vector<sf::Vector3f> discarded;
+        while (queue_.pop(discarded)) {}
+    }
+
+    // Called from the render loop only
+    bool poll(std::vector<sf::Vector3f>& chunk) { return queue_.pop(chunk); }
+
+    // Points generated and time spent since the last call
+    void take_generation_stats(size_t& count, float& ms) {
+        count = generated_.exchange(0);
+        ms = generation_us_.exchange(0) / 1000.0f;
+    }
+
+private:
+    SpscQueue<std::vector<sf::Vector3f>, 64> queue_;
+    std::thread worker_;
+    std::atomic<bool> running_{false};
+    std::atomic<size_t> generated_{0};
+    std::atomic<long long> generation_us_{0};
+};
+
+// =======================
+// Adaptive Point Budget
+// =======================
+
+// Grows or shrinks the number of drawn points to hold TARGET_FRAME_MS.
+// Samples are independent, so any prefix of the cloud is itself a valid
+// sample and changing the count never requires resampling.
+class PointBudgetController {
+public:
+    explicit PointBudgetController(size_t initial) : active_(initial) {}
+
+    size_t active() const { return active_; }
+
+    void record_generation(size_t count, float ms) {
+        if (count > 0)
+            gen_ms_per_point_ = smooth(gen_ms_per_point_, ms / count);
+    }
+
+    // work_ms is the frame's CPU + GPU time, excluding the frame-limiter wait
+    void record_frame(float work_ms, size_t drawn) {
+        if (drawn < active_)
+            return; // Cloud still filling, cost not representative yet
+        frame_ms_ = smooth(frame_ms_, work_ms);
+
+        float ratio = TARGET_FRAME_MS / std::fmax(frame_ms_, 0.01f);
+        if (ratio > 0.9f && ratio < 1.1f)
+            return; // Dead band to avoid oscillation
+        float next = active_ * std::fmax(0.8f, std::fmin(1.25f, ratio));
+
+        // Changing the orbital or species streams the whole cloud again
+        if (gen_ms_per_point_ > 0.0f)
+            next = std::fmin(next, MAX_REFILL_SECONDS * 1000.0f / gen_ms_per_point_);
+
+        active_ = static_cast<size_t>(std::fmax(MIN_ACTIVE_POINTS, std::fmin(MAX_ACTIVE_POINTS, next)));
+    }
+
+private:
+    static float smooth(float average, float sample) {
+        return average < 0.0f ? sample : 0.9f * average + 0.1f * sample;
+    }
+
+    size_t active_;
+    float frame_ms_ = -1.0f;
+    float gen_ms_per_point_ = -1.0f;
+};
+
+// =======================
+// Quantized Point Storage
+// =======================
+
+// Each axis is stored as 16-bit fixed point in [-radius, radius], so one step is
+// radius / 32767 and the max position error is half a step: radius / 65534.
+// The radius is the sampler's full extent, so no point is clamped. For 1s
+// (24 a0) that is 3.7e-4 a0, or ~0.05 px at the default zoom (camera at 10
+// units, 45 deg fov, 600 px high, scale 2).
+constexpr float QUANTIZATION_STEPS = 32767.0f;
+
+struct QuantizedPoint {
+    std::int16_t x, y, z;
+};
+
+struct QuantizedCloud {
+    float radius = 1.0f;
+    std::vector<QuantizedPoint> points;
+};
+
+std::int16_t quantize_coordinate(float v, float radius) {
+    float t = std::fmax(-1.0f, std::fmin(1.0f, v / radius));
+    return static_cast<std::int16_t>(std::lround(t * QUANTIZATION_STEPS));
+}
+
+// Writes points starting at offset, growing the cloud if needed
+void store_quantized(QuantizedCloud& cloud, const std::vector<sf::Vector3f>& points, size_t offset) {
+    if (cloud.points.size() < offset + points.size())
+        cloud.points.resize(offset + points.size());
+    for (size_t i = 0; i < points.size(); ++i) {
+        const auto& p = points[i];
+        cloud.points[offset + i] = {quantize_coordinate(p.x, cloud.radius),
+                                    quantize_coordinate(p.y, cloud.radius),
+                                    quantize_coordinate(p.z, cloud.radius)};
+    }
 }
 
 // =======================
-// Orbital Point Generator
+// Sampler Benchmark
 // =======================
 
-std::vector<sf::Vector3f> generate_orbital_points(const Orbital& orbital, float time) {
-    std::vector<sf::Vector3f> points;
-    std::random_device rd;
-    std::mt19937 gen(rd());
-    std::uniform_real_distribution<float> r_dist(0.0f, 8.0f * BOHR_RADIUS);
-    std::uniform_real_distribution<float> theta_dist(0.0f, PI);
-    std::uniform_real_distribution<float> phi_dist(0.0f, 2.0f * PI);
-    std::uniform_real_distribution<float> prob_dist(0.0f, 1.0f);
+// Effective samples per second of the available samplers, printed as a table
+// (run with --benchmark). The statistic is the radius; independent samplers
+// count every point. Rejection from a uniform ball under a unit density bound
+// is rated from its measured proposal rate and its exact acceptance
+// probability, since past n = 2 it would not finish.
+void benchmark_samplers() {
+    const std::vector<Orbital> cases = {
+        {1, 0, 0, 1.0f, "1s", sf::Vector3f()},   {2, 1, 0, 1.0f, "2pz", sf::Vector3f()},
+        {3, 2, 1, 1.0f, "3d", sf::Vector3f()},   {5, 3, -2, 1.0f, "5f", sf::Vector3f()},
+        {10, 4, 2, 1.0f, "10g", sf::Vector3f()}, {20, 0, 0, 1.0f, "20s", sf::Vector3f()},
+        {20, 10, 5, 1.0f, "20n", sf::Vector3f()}, {20, 19, 19, 1.0f, "20 circular", sf::Vector3f()},
+        {100, 0, 0, 1.0f, "100s", sf::Vector3f()}, {100, 99, 99, 1.0f, "100 circular", sf::Vector3f()}};
+    using Clock = std::chrono::steady_clock;
+    auto seconds_since = [](Clock::time_point start) { return std::chrono::duration<double>(Clock::now() - start).count(); };
+    auto radius = [](float x, float y, float z) { return std::sqrt(x * x + y * y + z * z); };
+    std::mt19937 gen(12345);
 
-    float max_prob = 1.0f; // Conservative or precomputed
+    std::printf("%-12s %14s %14s %14s %14s %10s %12s\n", "orbital", "exact ESS/s", "rejection/s", "RWM ESS/s", "MALA ESS/s",
+                "MALA acc", "MALA <r> err");
+    for (const Orbital& orbital : cases) {
+        // Exact: radial and polar CDFs (tables built outside the timing)
+        radial_cdf(orbital.n, orbital.l, orbital.species);
+        polar_cdf(orbital.l, std::abs(orbital.m));
+        const size_t exact_count = 200000;
+        auto start = Clock::now();
+        generate_orbital_points(orbital, exact_count, gen);
+        double exact_rate = exact_count / seconds_since(start);
 
-    while (points.size() < NUM_POINTS) {
-        float r = r_dist(gen);
-        float theta = theta_dist(gen);
-        float phi = phi_dist(gen);
-        float prob = probability_density(orbital, r, theta, phi, time);
+        // Uniform-ball rejection: proposal rate times acceptance = P(r < R) / (V max_prob)
+        float ball = sampling_radius(orbital);
+        double acceptance = radial_cdf(orbital.n, orbital.l, orbital.species).mass_within(ball) / (4.0 / 3.0 * PI * ball * ball * ball);
+        const int proposals = 200000;
+        std::uniform_real_distribution<float> unit_dist(0.0f, 1.0f);
+        volatile float sink = 0.0f; // Keeps the evaluations from being optimized out
+        start = Clock::now();
+        for (int i = 0; i < proposals; ++i)
+            sink = sink + probability_density(orbital, ball * std::cbrt(unit_dist(gen)), std::acos(2.0f * unit_dist(gen) - 1.0f),
+                                        2.0f * PI * unit_dist(gen), 0.0f);
+        double rejection_rate = proposals / seconds_since(start) * acceptance;
 
-        if (prob_dist(gen) < prob / max_prob) {
-            float x = r * std::sin(theta) * std::cos(phi);
-            float y = r * std::sin(theta) * std::sin(phi);
-            float z = r * std::cos(theta);
-            points.emplace_back(x, y, z);
+        // Chains start spread over the radial extent and burn in with step adaptation
+        double mcmc_rate[2], mala_acceptance = 0.0, mala_mean = 0.0;
+        for (int use_gradient = 0; use_gradient < 2; ++use_gradient) {
+            LangevinSampler sampler(orbital_log_density(orbital), 1024, 2.0f * orbital.n * orbital.n * BOHR_RADIUS,
+                                    0.5f * orbital.n * BOHR_RADIUS, use_gradient, true, 7u);
+            sampler.run(500, true);
+            sampler.reset_acceptance();
+            std::vector<float> trace;
+            start = Clock::now();
+            sampler.run(1000, false, &trace, radius);
+            double elapsed = seconds_since(start);
+            mcmc_rate[use_gradient] = effective_sample_size(trace, sampler.chains()) / elapsed;
+            if (use_gradient) {
+                mala_acceptance = sampler.acceptance();
+                for (float r : trace)
+                    mala_mean += r;
+                mala_mean /= trace.size();
+            }
         }
+        // <r> = (3 n^2 - l (l + 1)) a0 / 2
+        double expected = 0.5 * (3.0 * orbital.n * orbital.n - orbital.l * (orbital.l + 1)) * BOHR_RADIUS;
+        std::printf("%-12s %14.0f %14.3g %14.0f %14.0f %10.2f %11.2f%%\n", orbital.name.c_str(), exact_rate, rejection_rate,
+                    mcmc_rate[0], mcmc_rate[1], mala_acceptance, 100.0 * (mala_mean - expected) / expected);
     }
-
-    return points;
 }
 
 // =======================
 // Main
 // =======================
 
-int main() {
+enum class ViewMode {
+    Cloud,    // Progressive point cloud
+    Subshell, // All m of the current subshell (A)
+    Mesh,     // Isosurface enclosing MESH_ENCLOSED_FRACTION (M, E exports)
+    Slice,    // Cross-section facing the camera (S, D toggles density / signed psi)
+    Superposition, // (1s + current) / sqrt(2) evolving in time (P); 2pz pairs with 1s
+    Complex,      // e^{i m phi} form of the current orbital, colored by phase (X)
+    Bohmian,      // Points of (1s + complex current) / sqrt(2) carried by the probability current (B)
+    Hybrid,       // sp, sp2 or sp3 hybrids of the current shell, one color per hybrid (H cycles)
+    Shell,        // Total density of the current subshell, then of the closed shell (K cycles)
+    Molecule      // Two-center LCAO ion from the current orbital (O; N bonding / antibonding, [ ] bond length)
+};
+// R writes a raymarched VOLUME_IMAGE_WIDTH x VOLUME_IMAGE_HEIGHT frame of the current view
+
+int main(int argc, char** argv) {
+    if (argc > 1 && std::string(argv[1]) == "--benchmark") {
+        benchmark_samplers();
+        return 0;
+    }
+
     // SFML + OpenGL setup
     sf::ContextSettings settings;
     settings.depthBits = 24;
@@ -133,30 +4246,248 @@ int main() {
         {1, 0, 0, 2.0f, "1s", sf::Vector3f(1.0f, 0.0f, 0.0f)},       // 1
         {2, 1, 1, 2.0f, "2px", sf::Vector3f(0.0f, 1.0f, 0.0f)},      // 2
         {2, 1, -1, 2.0f, "2py", sf::Vector3f(0.0f, 0.5f, 1.0f)},     // 3
-        {2, 1, 0, 2.0f, "2pz", sf::Vector3f(1.0f, 1.0f, 0.0f)}       // 4
+        {2, 1, 0, 2.0f, "2pz", sf::Vector3f(1.0f, 1.0f, 0.0f)},      // 4
+        {100, 99, 99, 0.0f, "100 circular", sf::Vector3f(1.0f, 0.4f, 0.8f)} // 5
+    };
+    // A scale of 0 fits the orbital's sampling radius to the view. The radius
+    // depends on the species, so the fit is redone whenever it changes.
+    std::vector<bool> auto_scaled(orbitals.size());
+    for (size_t i = 0; i < orbitals.size(); ++i)
+        auto_scaled[i] = orbitals[i].scale <= 0.0f;
+    auto fit_scales = [&]() {
+        for (size_t i = 0; i < orbitals.size(); ++i)
+            if (auto_scaled[i])
+                orbitals[i].scale = 16.0f / sampling_radius(orbitals[i]);
     };
+    fit_scales();
 
     int current_orbital = 0;
     std::vector<sf::Vector3f> points;
+    QuantizedCloud quantized;
+    ProgressiveSampler sampler;
+    PointBudgetController budget(NUM_POINTS);
+    size_t stream_target = 0; // Cloud size the running or last stream fills up to
+    sf::Clock frame_clock;
 
     float camera_distance = 10.0f;
     float angle = 0.0f;
     sf::Clock clock;
-    float last_generation_time = -100.0f;
+    bool orbital_changed = true;
+
+    ViewMode view_mode = ViewMode::Cloud;
+
+    // Subshell mode: every m of the current (n, l) at once, sharing radial draws
+    std::vector<std::vector<sf::Vector3f>> subshell_clouds;
+    std::mt19937 subshell_gen(std::random_device{}());
+
+    // Mesh mode: rebuilt when the orbital changes
+    Mesh mesh;
+    bool mesh_dirty = true;
+
+    bool slice_signed = false;
+    std::unique_ptr<BrickMap> brick_map; // Density slices, refined as the plane sweeps through
+
+    // Imported cube: replaces the analytic density in the slice and volume views
+    DensityGrid imported;
+    DensityGrid imported_density; // |psi|^2 when the cube holds psi
+    CompressedGrid imported_compressed; // Set when the grid came from a .ocg file
+    bool imported_signed = false;
+    std::unique_ptr<GridSampler> grid_sampler; // Fills the cloud from the imported density
+
+    // Superposition mode: basis values cached once, phases recombined per frame
+    SuperpositionCloud superposition;
+    std::mt19937 superposition_gen(std::random_device{}());
+
+    // Complex mode: points and their phase colors, rebuilt when the orbital changes
+    std::vector<sf::Vector3f> complex_points, complex_colors;
+
+    // Bohmian mode: sampled once, then only advected
+    BohmianCloud bohmian;
+    float bohmian_time = 0.0f, bohmian_clock = 0.0f;
+
+    // Hybrid mode: all hybrids from one mixture draw, rebuilt when the orbital or kind changes
+    Hybridization hybridization = Hybridization::SP;
+    std::vector<std::vector<sf::Vector3f>> hybrid_clouds;
+
+    // Shell mode: spherical cloud with per-point opacity from the shell density
+    bool closed_shell = false;
+    std::vector<sf::Vector3f> shell_points;
+    std::vector<float> shell_alpha;
+
+    // Molecule mode: points colored by the sign of psi, nuclei drawn in white
+    float bond_length = 2.0f * BOHR_RADIUS;
+    bool bonding = true;
+    std::vector<sf::Vector3f> molecule_points, molecule_colors;
+
+    // Z cycles the species of every orbital in the list
+    size_t species_index = 0;
+
+    // Drops everything derived from the current orbital
+    auto invalidate_views = [&]() {
+        subshell_clouds.clear();
+        mesh_dirty = true;
+        brick_map.reset();
+        superposition = SuperpositionCloud();
+        complex_points.clear();
+        bohmian = BohmianCloud();
+        hybrid_clouds.clear();
+        shell_points.clear();
+        molecule_points.clear();
+        if (grid_sampler) {
+            grid_sampler.reset();
+            orbital_changed = true;
+        }
+        imported = imported_density = DensityGrid();
+    };
 
     while (window.isOpen()) {
+        frame_clock.restart();
         sf::Event event;
         while (window.pollEvent(event)) {
             if (event.type == sf::Event::Closed)
                 window.close();
             else if (event.type == sf::Event::KeyPressed) {
-                if (event.key.code >= sf::Keyboard::Num1 && event.key.code <= sf::Keyboard::Num4) {
+                if (event.key.code >= sf::Keyboard::Num1 && event.key.code <= sf::Keyboard::Num9) {
                     int index = event.key.code - sf::Keyboard::Num1;
                     if (index < orbitals.size()) {
+                        // Orbitals in the same symmetry class keep the cloud, only the transform changes
+                        bool reuse = same_symmetry_class(orbitals[current_orbital], orbitals[index]);
                         current_orbital = index;
                         std::cout << "Switched to orbital: " << orbitals[current_orbital].name << "\n";
-                        last_generation_time = -100.0f;
+                        if (!reuse)
+                            orbital_changed = true;
+                        invalidate_views();
+                    }
+                } else if (event.key.code == sf::Keyboard::Z) {
+                    // Tables and clouds are cached per species, so cycling back is instant
+                    species_index = (species_index + 1) % (sizeof(SPECIES) / sizeof(SPECIES[0]));
+                    for (Orbital& o : orbitals)
+                        o.species = SPECIES[species_index];
+                    fit_scales();
+                    std::cout << "Species: " << SPECIES[species_index].name << "\n";
+                    orbital_changed = true;
+                    invalidate_views();
+                } else if (event.key.code == sf::Keyboard::A) {
+                    view_mode = view_mode == ViewMode::Subshell ? ViewMode::Cloud : ViewMode::Subshell;
+                    subshell_clouds.clear();
+                } else if (event.key.code == sf::Keyboard::B) {
+                    view_mode = view_mode == ViewMode::Bohmian ? ViewMode::Cloud : ViewMode::Bohmian;
+                    bohmian = BohmianCloud();
+                } else if (event.key.code == sf::Keyboard::O) {
+                    view_mode = view_mode == ViewMode::Molecule ? ViewMode::Cloud : ViewMode::Molecule;
+                    molecule_points.clear();
+                } else if (event.key.code == sf::Keyboard::N) {
+                    bonding = !bonding;
+                    molecule_points.clear();
+                } else if (event.key.code == sf::Keyboard::LBracket || event.key.code == sf::Keyboard::RBracket) {
+                    float step = event.key.code == sf::Keyboard::RBracket ? 0.25f : -0.25f;
+                    bond_length = std::fmin(std::fmax(bond_length + step * BOHR_RADIUS, 0.25f * BOHR_RADIUS), 20.0f * BOHR_RADIUS);
+                    std::cout << "Bond length: " << bond_length << " a0\n";
+                    molecule_points.clear();
+                } else if (event.key.code == sf::Keyboard::K) {
+                    // Cloud -> subshell -> closed shell -> cloud
+                    if (view_mode != ViewMode::Shell) {
+                        view_mode = ViewMode::Shell;
+                        closed_shell = false;
+                    } else if (!closed_shell) {
+                        closed_shell = true;
+                    } else {
+                        view_mode = ViewMode::Cloud;
                     }
+                    shell_points.clear();
+                } else if (event.key.code == sf::Keyboard::H) {
+                    // Cloud -> sp -> sp2 -> sp3 -> cloud
+                    if (view_mode != ViewMode::Hybrid) {
+                        view_mode = ViewMode::Hybrid;
+                        hybridization = Hybridization::SP;
+                    } else if (hybridization == Hybridization::SP) {
+                        hybridization = Hybridization::SP2;
+                    } else if (hybridization == Hybridization::SP2) {
+                        hybridization = Hybridization::SP3;
+                    } else {
+                        view_mode = ViewMode::Cloud;
+                    }
+                    hybrid_clouds.clear();
+                } else if (event.key.code == sf::Keyboard::X) {
+                    view_mode = view_mode == ViewMode::Complex ? ViewMode::Cloud : ViewMode::Complex;
+                } else if (event.key.code == sf::Keyboard::P) {
+                    view_mode = view_mode == ViewMode::Superposition ? ViewMode::Cloud : ViewMode::Superposition;
+                } else if (event.key.code == sf::Keyboard::M) {
+                    view_mode = view_mode == ViewMode::Mesh ? ViewMode::Cloud : ViewMode::Mesh;
+                } else if (event.key.code == sf::Keyboard::S) {
+                    view_mode = view_mode == ViewMode::Slice ? ViewMode::Cloud : ViewMode::Slice;
+                } else if (event.key.code == sf::Keyboard::D) {
+                    slice_signed = !slice_signed;
+                } else if (event.key.code == sf::Keyboard::R) {
+                    const Orbital& o = orbitals[current_orbital];
+                    OrbitCamera camera;
+                    camera.distance = camera_distance;
+                    camera.angle = angle;
+                    camera.scale = o.scale;
+                    sf::Clock render_clock;
+                    float time = clock.getElapsedTime().asSeconds();
+                    Image image;
+                    if (imported.values.empty()) {
+                        image = render_volume(analytic_source(o, time), camera, o.color, VOLUME_IMAGE_WIDTH, VOLUME_IMAGE_HEIGHT);
+                    } else if (!imported_compressed.blocks.empty() && !imported_signed) {
+                        // A compressed density renders straight from its codes
+                        DensitySource source = compressed_source(imported_compressed, orbital_isovalue(o, 0.05f, 0.0f));
+                        image = render_volume(source, camera, o.color, VOLUME_IMAGE_WIDTH, VOLUME_IMAGE_HEIGHT);
+                    } else {
+                        DensitySource source = grid_source(imported_density, orbital_isovalue(o, 0.05f, 0.0f));
+                        image = render_volume(source, camera, o.color, VOLUME_IMAGE_WIDTH, VOLUME_IMAGE_HEIGHT);
+                    }
+                    float ms = render_clock.getElapsedTime().asMicroseconds() / 1000.0f;
+                    if (write_ppm(image, o.name + "_volume.ppm"))
+                        std::cout << "Rendered " << o.name << "_volume.ppm in " << ms << " ms\n";
+                } else if (event.key.code == sf::Keyboard::C) {
+                    // Exports psi in signed slice mode, |psi|^2 otherwise
+                    const Orbital& o = orbitals[current_orbital];
+                    DensityGrid grid = voxelize_orbital(o, MESH_RESOLUTION, sampling_radius(o), 0.0f, slice_signed);
+                    std::string comment = o.name + (slice_signed ? " wavefunction" : " probability density");
+                    if (write_cube(grid, comment, o.name + ".cube"))
+                        std::cout << "Exported " << o.name << ".cube\n";
+                    else
+                        std::cout << "Cube export failed\n";
+                    // Compressed copy alongside: log codes keep the density's tails, psi changes sign
+                    CompressedGrid compressed = slice_signed ? compress_grid(grid, 16, Quantization::Linear)
+                                                             : compress_grid(grid, 12, Quantization::Log);
+                    if (save_compressed_grid(compressed, o.name + ".ocg"))
+                        std::cout << "Exported " << o.name << ".ocg (" << compressed.memory_bytes() / 1024 << " KiB, "
+                                  << (slice_signed ? "max error " : "max relative error ") << compressed.error_bound() << ")\n";
+                    else
+                        std::cout << "Compressed export failed\n";
+                } else if (event.key.code == sf::Keyboard::I) {
+                    // Toggles <name>.cube (or <name>.ocg when there is no cube) in place of the
+                    // analytic density, reporting how far they differ
+                    const Orbital& o = orbitals[current_orbital];
+                    std::string source;
+                    if (!imported.values.empty()) {
+                        imported = imported_density = DensityGrid();
+                        imported_compressed = CompressedGrid();
+                        grid_sampler.reset();
+                        orbital_changed = true;
+                        std::cout << "Using analytic density\n";
+                    } else if (read_grid(o.name, imported, imported_compressed, source)) {
+                        imported_signed = std::any_of(imported.values.begin(), imported.values.end(), [](float v) { return v < 0.0f; });
+                        imported_density = imported;
+                        if (imported_signed)
+                            for (float& value : imported_density.values)
+                                value *= value;
+                        grid_sampler.reset(new GridSampler(imported_density, true));
+                        orbital_changed = true;
+                        std::cout << "Imported " << source << " (" << imported.nx << "x" << imported.ny << "x" << imported.nz
+                                  << (imported_signed ? ", psi" : ", density") << "), max deviation from analytic "
+                                  << 100.0f * grid_deviation(imported, o, imported_signed) << "% of peak\n";
+                    } else {
+                        std::cout << "Could not read " << o.name << ".cube or " << o.name << ".ocg\n";
+                    }
+                } else if (event.key.code == sf::Keyboard::E && !mesh_dirty) {
+                    const Orbital& o = orbitals[current_orbital];
+                    if (write_obj(mesh, o, o.name + ".obj") && write_ply(mesh, o, o.name + ".ply"))
+                        std::cout << "Exported " << o.name << ".obj and " << o.name << ".ply\n";
+                    else
+                        std::cout << "Mesh export failed\n";
                 }
             }
         }
@@ -164,12 +4495,55 @@ int main() {
         float time = clock.getElapsedTime().asSeconds();
         angle += ROTATION_SPEED;
 
-        // Regenerate points only every 0.5s
-        if (time - last_generation_time > 0.5f) {
-            points = generate_orbital_points(orbitals[current_orbital], time);
-            last_generation_time = time;
+        if (orbital_changed) {
+            sampler.stop(); // Drops chunks of the old orbital still in flight
+            points.clear();
+            quantized.points.clear();
+            quantized.radius = sampling_extent(orbitals[current_orbital]);
+            stream_target = 0;
+            orbital_changed = false;
+            if (grid_sampler) {
+                const DensityGrid& grid = imported_density;
+                sf::Vector3f far = grid.position(grid.nx - 1, grid.ny - 1, grid.nz - 1);
+                quantized.radius = std::fmax(std::fmax(std::fabs(grid.origin.x), std::fabs(far.x)),
+                                             std::fmax(std::fmax(std::fabs(grid.origin.y), std::fabs(far.y)),
+                                                       std::fmax(std::fabs(grid.origin.z), std::fabs(far.z))));
+            }
+        }
+
+        // The sampled distribution does not depend on time, so the stream stops
+        // once the cloud holds budget.active() points and only starts again when
+        // the orbital or species changes (above) or the budget outgrows the
+        // cloud, which adds just the missing points. A smaller budget draws a
+        // prefix of the cloud.
+        auto append_points = [&](const std::vector<sf::Vector3f>& batch) {
+            if (USE_QUANTIZED_POINTS)
+                store_quantized(quantized, batch, quantized.points.size());
+            else
+                points.insert(points.end(), batch.begin(), batch.end());
+        };
+        size_t cloud_size = USE_QUANTIZED_POINTS ? quantized.points.size() : points.size();
+        if (cloud_size >= stream_target && budget.active() > cloud_size) {
+            size_t missing = budget.active() - cloud_size;
+            if (grid_sampler) {
+                // Imported density: one rejection-free batch, on this thread
+                if (!grid_sampler->empty())
+                    append_points(grid_sampler->generate(missing, std::random_device{}()));
+            } else {
+                sampler.start(symmetry_map(orbitals[current_orbital]).canonical, missing);
+            }
+            stream_target = budget.active();
         }
 
+        std::vector<sf::Vector3f> chunk;
+        while (!grid_sampler && sampler.poll(chunk))
+            append_points(chunk);
+
+        size_t generated_count;
+        float generation_ms;
+        sampler.take_generation_stats(generated_count, generation_ms);
+        budget.record_generation(generated_count, generation_ms);
+
         window.clear();
         glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
         glViewport(0, 0, WINDOW_WIDTH, WINDOW_HEIGHT);
@@ -184,14 +4558,270 @@ int main() {
                   0.0f, 0.0f, 0.0f,
                   0.0f, 1.0f, 0.0f);
 
-        // Render points      
-        glBegin(GL_POINTS);
-        for (const auto& p : points) {
+        if (view_mode == ViewMode::Subshell) {
+            const Orbital& o = orbitals[current_orbital];
+            if (subshell_clouds.empty())
+                subshell_clouds = generate_subshell_points(o.n, o.l, o.species, budget.active() / (2 * o.l + 1), subshell_gen);
+
+            glBegin(GL_POINTS);
+            for (int m = -o.l; m <= o.l; ++m) {
+                sf::Vector3f c = o.color;
+                for (const auto& other : orbitals)
+                    if (other.n == o.n && other.l == o.l && other.m == m)
+                        c = other.color;
+                glColor4f(c.x, c.y, c.z, 0.5f);
+                for (const auto& p : subshell_clouds[m + o.l])
+                    glVertex3f(p.x * o.scale, p.y * o.scale, p.z * o.scale);
+            }
+            glEnd();
+            window.display();
+            continue;
+        }
+
+        if (view_mode == ViewMode::Superposition) {
+            const Orbital& o = orbitals[current_orbital];
+            Orbital ground = orbitals[0];
+            Orbital partner = o.n == 1 ? orbitals[3] : o;
+            if (superposition.empty())
+                superposition.build(make_superposition({ground, partner}), budget.active(), superposition_gen);
+
+            float scale = partner.scale;
+            sf::Vector3f c(0.5f * (ground.color.x + partner.color.x), 0.5f * (ground.color.y + partner.color.y),
+                           0.5f * (ground.color.z + partner.color.z));
+            glColor4f(c.x, c.y, c.z, 0.5f);
+            glBegin(GL_POINTS);
+            for (const auto& p : superposition.evaluate(time))
+                glVertex3f(p.x * scale, p.y * scale, p.z * scale);
+            glEnd();
+            window.display();
+            continue;
+        }
+
+        if (view_mode == ViewMode::Bohmian) {
+            const Orbital& o = orbitals[current_orbital];
+            Orbital partner = o.n == 1 ? orbitals[3] : o;
+            if (bohmian.empty()) {
+                bohmian.build(make_superposition({orbitals[0], partner}), true, BOHMIAN_POINTS, subshell_gen);
+                bohmian_time = 0.0f;
+            } else {
+                float dt = std::fmin(time - bohmian_clock, 0.1f) * SUPERPOSITION_TIME_SCALE;
+                bohmian.advance(bohmian_time, dt);
+                bohmian_time += dt;
+            }
+            bohmian_clock = time;
+
+            float scale = partner.scale;
+            glColor4f(partner.color.x, partner.color.y, partner.color.z, 0.5f);
+            glBegin(GL_POINTS);
+            for (size_t i = 0; i < bohmian.size(); ++i) {
+                sf::Vector3f p = bohmian.point(i);
+                glVertex3f(p.x * scale, p.y * scale, p.z * scale);
+            }
+            glEnd();
+            window.display();
+            continue;
+        }
+
+        if (view_mode == ViewMode::Molecule) {
+            const Orbital& o = orbitals[current_orbital];
+            MolecularOrbital mo{o, bond_length, bonding};
+            if (molecule_points.empty()) {
+                molecule_points = sample_molecular_orbital(mo, budget.active(), subshell_gen);
+                size_t count = molecule_points.size();
+                PointBatch batch(molecule_points);
+                std::vector<float> psi(count);
+                molecular_wavefunction_batch(mo, batch.x.data(), batch.y.data(), batch.z.data(), count, psi.data());
+                sf::Vector3f negative(1.0f - o.color.x, 1.0f - o.color.y, 1.0f - o.color.z);
+                molecule_colors.resize(count);
+                for (size_t i = 0; i < count; ++i)
+                    molecule_colors[i] = psi[i] >= 0.0f ? o.color : negative;
+                std::cout << (bonding ? "Bonding" : "Antibonding") << " " << o.name << " pair, overlap "
+                          << molecular_overlap(mo) << "\n";
+            }
+
+            glBegin(GL_POINTS);
+            for (size_t i = 0; i < molecule_points.size(); ++i) {
+                const auto& p = molecule_points[i];
+                const auto& c = molecule_colors[i];
+                glColor4f(c.x, c.y, c.z, 0.5f);
+                glVertex3f(p.x * o.scale, p.y * o.scale, p.z * o.scale);
+            }
+            glEnd();
+            glPointSize(8.0f);
+            glBegin(GL_POINTS);
+            glColor4f(1.0f, 1.0f, 1.0f, 1.0f);
+            glVertex3f(0.0f, 0.0f, -0.5f * bond_length * o.scale);
+            glVertex3f(0.0f, 0.0f, 0.5f * bond_length * o.scale);
+            glEnd();
+            glPointSize(2.0f);
+            window.display();
+            continue;
+        }
+
+        if (view_mode == ViewMode::Shell) {
+            const Orbital& o = orbitals[current_orbital];
+            if (shell_points.empty()) {
+                shell_points = sample_shell(o, closed_shell, budget.active(), subshell_gen);
+                size_t count = shell_points.size();
+                PointBatch batch(shell_points);
+                std::vector<float> density(count);
+                shell_density_batch(o, closed_shell, batch.x.data(), batch.y.data(), batch.z.data(), count, 0.0f, density.data());
+                float peak = *std::max_element(density.begin(), density.end());
+                shell_alpha.resize(count);
+                for (size_t i = 0; i < count; ++i)
+                    shell_alpha[i] = 0.15f + 0.6f * std::cbrt(density[i] / peak);
+            }
+
+            glBegin(GL_POINTS);
+            for (size_t i = 0; i < shell_points.size(); ++i) {
+                const auto& p = shell_points[i];
+                glColor4f(o.color.x, o.color.y, o.color.z, shell_alpha[i]);
+                glVertex3f(p.x * o.scale, p.y * o.scale, p.z * o.scale);
+            }
+            glEnd();
+            window.display();
+            continue;
+        }
+
+        if (view_mode == ViewMode::Hybrid) {
+            const Orbital& o = orbitals[current_orbital];
+            if (hybrid_clouds.empty())
+                hybrid_clouds = sample_hybrids(make_hybrids(std::max(o.n, 2), hybridization, o.species), budget.active(), subshell_gen);
+
+            const sf::Vector3f colors[] = {sf::Vector3f(1.0f, 0.3f, 0.3f), sf::Vector3f(0.3f, 1.0f, 0.3f),
+                                           sf::Vector3f(0.3f, 0.5f, 1.0f), sf::Vector3f(1.0f, 1.0f, 0.3f)};
+            glBegin(GL_POINTS);
+            for (size_t h = 0; h < hybrid_clouds.size(); ++h) {
+                const sf::Vector3f& c = colors[h % 4];
+                glColor4f(c.x, c.y, c.z, 0.5f);
+                for (const auto& p : hybrid_clouds[h])
+                    glVertex3f(p.x * o.scale, p.y * o.scale, p.z * o.scale);
+            }
+            glEnd();
+            window.display();
+            continue;
+        }
+
+        if (view_mode == ViewMode::Complex) {
+            const Orbital& o = orbitals[current_orbital];
+            if (complex_points.empty()) {
+                complex_points = sample_complex_orbital(o, budget.active(), subshell_gen);
+                size_t count = complex_points.size();
+                PointBatch batch(complex_points);
+                std::vector<float> density(count), phase_re(count), phase_im(count);
+                complex_wavefunction_batch(o, batch.x.data(), batch.y.data(), batch.z.data(), count, density.data(), phase_re.data(),
+                                           phase_im.data());
+                complex_colors.resize(count);
+                for (size_t i = 0; i < count; ++i)
+                    complex_colors[i] = phase_hue(phase_re[i], phase_im[i]);
+            }
+
+            glBegin(GL_POINTS);
+            for (size_t i = 0; i < complex_points.size(); ++i) {
+                const auto& p = complex_points[i];
+                const auto& c = complex_colors[i];
+                glColor4f(c.x, c.y, c.z, 0.5f);
+                glVertex3f(p.x * o.scale, p.y * o.scale, p.z * o.scale);
+            }
+            glEnd();
+            window.display();
+            continue;
+        }
+
+        if (view_mode == ViewMode::Slice) {
+            const Orbital& o = orbitals[current_orbital];
+            OrbitCamera camera;
+            camera.distance = camera_distance;
+            camera.angle = angle;
+            camera.scale = o.scale;
+            if (!imported.values.empty()) {
+                bool show_psi = imported_signed && slice_signed;
+                const DensityGrid& grid = show_psi ? imported : imported_density;
+                DensityBatchFn evaluate = [&grid](const float* x, const float* y, const float* z, size_t count, float* out) {
+                    for (size_t i = 0; i < count; ++i)
+                        out[i] = grid.sample(x[i], y[i], z[i]);
+                };
+                draw_image(render_slice(evaluate, camera_slice(camera), WINDOW_WIDTH, WINDOW_HEIGHT, show_psi, o));
+            } else if (slice_signed) {
+                draw_image(render_slice(o, camera_slice(camera), WINDOW_WIDTH, WINDOW_HEIGHT, true, time));
+            } else {
+                // The vibration factor is a uniform scale, which the slice normalization removes
+                if (!brick_map)
+                    brick_map = make_orbital_brick_map(o, 32, 0.0f);
+                BrickMap* map = brick_map.get();
+                DensityBatchFn evaluate = [map](const float* x, const float* y, const float* z, size_t count, float* out) {
+                    for (size_t i = 0; i < count; ++i)
+                        out[i] = map->sample(x[i], y[i], z[i]);
+                };
+                draw_image(render_slice(evaluate, camera_slice(camera), WINDOW_WIDTH, WINDOW_HEIGHT, false, o));
+            }
+            window.display();
+            continue;
+        }
+
+        if (view_mode == ViewMode::Mesh) {
+            const Orbital& o = orbitals[current_orbital];
+            if (mesh_dirty) {
+                mesh = build_orbital_mesh(o, time);
+                mesh_dirty = false;
+            }
+
+            // Two-sided headlight shading from the analytic normals
+            sf::Vector3f eye(std::sin(angle), 0.0f, std::cos(angle));
+            glBegin(GL_TRIANGLES);
+            for (std::uint32_t index : mesh.indices) {
+                const auto& v = mesh.vertices[index];
+                const auto& n = mesh.normals[index];
+                float shade = 0.3f + 0.7f * std::fabs(n.x * eye.x + n.y * eye.y + n.z * eye.z);
+                sf::Vector3f c = phase_color(o, mesh.phase[index]);
+                glColor4f(c.x * shade, c.y * shade, c.z * shade, 0.6f);
+                glVertex3f(v.x * o.scale, v.y * o.scale, v.z * o.scale);
+            }
+            glEnd();
+            window.display();
+            continue;
+        }
+
+        // The cloud is stored in the canonical frame; map it to the current orbital
+        // (an imported cloud is already in the orbital's own frame)
+        SymmetryMap symmetry = symmetry_map(orbitals[current_orbital]);
+        if (grid_sampler)
+            set_matrix(symmetry.matrix, {1, 0, 0, 0, 1, 0, 0, 0, 1});
+        const float* M = symmetry.matrix;
+        float symmetry_matrix[16] = {M[0], M[3], M[6], 0.0f,
+                                     M[1], M[4], M[7], 0.0f,
+                                     M[2], M[5], M[8], 0.0f,
+                                     0.0f, 0.0f, 0.0f, 1.0f}; // Column-major
+        glMultMatrixf(symmetry_matrix);
+
+        // Render points (only the active prefix)
+        cloud_size = USE_QUANTIZED_POINTS ? quantized.points.size() : points.size();
+        size_t drawn = std::min(cloud_size, budget.active());
+        if (USE_QUANTIZED_POINTS) {
+            // Dequantize in the vertex path: integer vertices, scale folded into the modelview
+            float s = orbitals[current_orbital].scale * quantized.radius / QUANTIZATION_STEPS;
             sf::Vector3f c = orbitals[current_orbital].color;
+            glPushMatrix();
+            glScalef(s, s, s);
             glColor4f(c.x, c.y, c.z, 0.5f);
-            glVertex3f(p.x * orbitals[current_orbital].scale, p.y * orbitals[current_orbital].scale, p.z * orbitals[current_orbital].scale);
+            glBegin(GL_POINTS);
+            for (size_t i = 0; i < drawn; ++i)
+                glVertex3s(quantized.points[i].x, quantized.points[i].y, quantized.points[i].z);
+            glEnd();
+            glPopMatrix();
+        } else {
+            glBegin(GL_POINTS);
+            for (size_t i = 0; i < drawn; ++i) {
+                const auto& p = points[i];
+                sf::Vector3f c = orbitals[current_orbital].color;
+                glColor4f(c.x, c.y, c.z, 0.5f);
+                glVertex3f(p.x * orbitals[current_orbital].scale, p.y * orbitals[current_orbital].scale, p.z * orbitals[current_orbital].scale);
+            }
+            glEnd();
         }
-        glEnd();
+
+        glFinish();
+        budget.record_frame(frame_clock.getElapsedTime().asMicroseconds() / 1000.0f, drawn);
 
         window.display();
     }